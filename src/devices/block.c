@@ -4,6 +4,15 @@
 #include <stdio.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+/* === ADD START p4q15 ===*/
+#include "devices/iosched.h"
+#include "devices/timer.h"
+#include "threads/thread.h"
+/* === ADD END p4q15 ===*/
+/* === ADD START p4q16 ===*/
+#include <iostat.h>
+#include "threads/interrupt.h"
+/* === ADD END p4q16 ===*/
 
 /* A block device. */
 struct block
@@ -19,8 +28,88 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    /* === ADD START p4q13 ===*/
+    unsigned long long read_req_cnt;    /* Number of read requests. */
+    unsigned long long write_req_cnt;   /* Number of write requests. */
+    /* === ADD END p4q13 ===*/
+    /* === ADD START p4q15 ===*/
+    struct block_queue *queue;          /* Request queue, if any. */
+    struct block *parent;               /* Disk holding this partition. */
+    block_sector_t start;               /* First sector within PARENT. */
+    /* === ADD END p4q15 ===*/
+    /* === ADD START p4q16 ===*/
+
+    /* Request statistics.  Updated with interrupts off. */
+    unsigned long long io_cnt[2];       /* Requests done: reads, writes. */
+    int64_t queue_us;                   /* Total us waiting in queue. */
+    int64_t service_us;                 /* Total us being transferred. */
+    unsigned depth;                     /* Requests outstanding. */
+    unsigned peak_depth;                /* Most requests outstanding. */
+    unsigned long long hist[IOSTAT_HIST_CNT];   /* Latency histogram. */
+    /* === ADD END p4q16 ===*/
   };
 
+/* === ADD START p4q13 ===*/
+/* Sectors that block_read_multi() and block_write_multi() pass to
+   a driver in one request. */
+#define MULTI_MAX 32
+/* === ADD END p4q13 ===*/
+
+/* === ADD START p4q15 ===*/
+/* Request queues.
+
+   A device with a request queue is served by a thread of its own,
+   one request at a time.  Callers submit requests to the queue
+   and, separately, wait for them to complete, so that a caller
+   may have several requests outstanding at once.  When the
+   driver's completion interrupt wakes the thread from one
+   request, it picks the next one by the device's ordering policy
+   (see iosched.c) and merges into it any queued requests in the
+   same direction for the sectors just before or after it, so that
+   they become one transfer.
+
+   Partitions do not have queues of their own: their requests go
+   to the queue of the disk that holds them, where they are
+   ordered together with the requests for the disk's other
+   partitions.
+
+   Each request is counted, with the time it waited in the queue
+   and the time its transfer took, both against the device it was
+   submitted to and, for a partition, against the disk that holds
+   it.  A device without a queue counts its requests' whole time
+   as service. */
+
+/* Most sectors in one transfer made of merged requests. */
+#define MERGE_MAX 256
+
+/* Ticks within which a read or a write is served, under the
+   "deadline" policy. */
+#define READ_EXPIRE (TIMER_FREQ / 2)
+#define WRITE_EXPIRE (TIMER_FREQ * 5)
+
+/* A block device's request queue. */
+struct block_queue
+  {
+    const struct iosched *sched;        /* Ordering policy. */
+    struct lock lock;                   /* Protects REQUESTS and HEAD. */
+    struct condition not_empty;         /* Signaled when REQUESTS grows. */
+    struct list requests;               /* Requests not yet started. */
+    block_sector_t head;                /* Sector after the last served. */
+    void *buffers[MERGE_MAX];           /* Buffers of merged requests. */
+    unsigned long long merge_cnt;       /* Requests merged into others. */
+  };
+
+static void transfer (struct block *, bool write, block_sector_t,
+                      size_t cnt, void *const buffers[]);
+static void queue_daemon (void *block_);
+static struct block *get_disk (struct block *, block_sector_t *offset);
+/* === ADD END p4q15 ===*/
+/* === ADD START p4q16 ===*/
+static void count_submit (struct block *);
+static void count_complete (struct block *, const struct block_request *,
+                            int64_t started, int64_t finished);
+/* === ADD END p4q16 ===*/
+
 /* List of all block devices. */
 static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 
@@ -120,9 +209,8 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  /* === MODIFY p4q15 === */
+  block_readv (block, sector, 1, &buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,12 +221,494 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
-  check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  /* === MODIFY p4q15 === */
+  block_writev (block, sector, 1, &buffer);
+}
+
+/* === ADD START p4q13 ===*/
+/* Reads the CNT sectors starting at SECTOR from BLOCK, the Ith
+   of them into BUFFERS[I], each of which must have room for
+   BLOCK_SECTOR_SIZE bytes.  A driver that can transfer a run of
+   sectors does so as one request.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_readv (struct block *block, block_sector_t sector, size_t cnt,
+             void *const buffers[])
+{
+  /* === MODIFY START p4q15 ===*/
+  struct block_request r;
+
+  if (cnt == 0)
+    return;
+  block_request_init (&r, false, sector, cnt, buffers);
+  block_submit (block, &r);
+  block_wait (&r);
+  /* === MODIFY END p4q15 ===*/
 }
 
+/* Writes the CNT sectors starting at SECTOR to BLOCK, the Ith of
+   them from BUFFERS[I], each of which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the block device has
+   acknowledged receiving all of the data.  A driver that can
+   transfer a run of sectors does so as one request.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_writev (struct block *block, block_sector_t sector, size_t cnt,
+              const void *const buffers[])
+{
+  /* === MODIFY START p4q15 ===*/
+  struct block_request r;
+
+  if (cnt == 0)
+    return;
+  block_request_init (&r, true, sector, cnt, (void *const *) buffers);
+  block_submit (block, &r);
+  block_wait (&r);
+  /* === MODIFY END p4q15 ===*/
+}
+
+/* Reads the CNT sectors starting at SECTOR from BLOCK into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+void
+block_read_multi (struct block *block, block_sector_t sector, size_t cnt,
+                  void *buffer_)
+{
+  uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      void *buffers[MULTI_MAX];
+      size_t n = cnt < MULTI_MAX ? cnt : MULTI_MAX;
+      size_t i;
+
+      for (i = 0; i < n; i++)
+        buffers[i] = buffer + i * BLOCK_SECTOR_SIZE;
+      block_readv (block, sector, n, buffers);
+      sector += n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+      cnt -= n;
+    }
+}
+
+/* Writes the CNT sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving the
+   data. */
+void
+block_write_multi (struct block *block, block_sector_t sector, size_t cnt,
+                   const void *buffer_)
+{
+  const uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      const void *buffers[MULTI_MAX];
+      size_t n = cnt < MULTI_MAX ? cnt : MULTI_MAX;
+      size_t i;
+
+      for (i = 0; i < n; i++)
+        buffers[i] = buffer + i * BLOCK_SECTOR_SIZE;
+      block_writev (block, sector, n, buffers);
+      sector += n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+      cnt -= n;
+    }
+}
+/* === ADD END p4q13 ===*/
+
+/* === ADD START p4q15 ===*/
+/* Initializes R as a request to transfer the CNT sectors starting
+   at SECTOR, the Ith of them to or from BUFFERS[I].  R reads the
+   sectors into the buffers, unless WRITE is true, in which case
+   it writes them from the buffers, which it does not modify. */
+void
+block_request_init (struct block_request *r, bool write,
+                    block_sector_t sector, size_t cnt,
+                    void *const buffers[])
+{
+  r->write = write;
+  r->sector = sector;
+  r->cnt = cnt;
+  r->buffers = buffers;
+  sema_init (&r->done, 0);
+}
+
+/* Starts request R on BLOCK and returns without waiting for it
+   to complete.  R and its buffers must stay in place until
+   block_wait() returns for R.  On a device without a request
+   queue, R is carried out before returning.  A request for a
+   partition is queued at the disk that holds it, with its
+   sector translated to the disk's. */
+void
+block_submit (struct block *block, struct block_request *r)
+{
+  block_sector_t offset;
+  struct block *disk = get_disk (block, &offset);
+  struct block_queue *q = disk->queue;
+
+  ASSERT (r->cnt > 0);
+  check_sector (block, r->sector);
+  check_sector (block, r->sector + r->cnt - 1);
+  ASSERT (!r->write || block->type != BLOCK_FOREIGN);
+
+  r->origin = block;
+  /* === ADD START p4q16 ===*/
+  r->submitted = timer_usecs ();
+  count_submit (block);
+  /* === ADD END p4q16 ===*/
+  if (q == NULL)
+    {
+      transfer (block, r->write, r->sector, r->cnt, r->buffers);
+      /* === ADD p4q16 === */
+      count_complete (block, r, r->submitted, timer_usecs ());
+      sema_up (&r->done);
+      return;
+    }
+
+  r->sector += offset;
+  /* === ADD START p4q16 ===*/
+  if (disk != block)
+    count_submit (disk);
+  /* === ADD END p4q16 ===*/
+  r->deadline = timer_ticks () + (r->write ? WRITE_EXPIRE : READ_EXPIRE);
+  lock_acquire (&q->lock);
+  list_push_back (&q->requests, &r->elem);
+  cond_signal (&q->not_empty, &q->lock);
+  lock_release (&q->lock);
+}
+
+/* Waits for request R, started with block_submit(), to
+   complete. */
+void
+block_wait (struct block_request *r)
+{
+  sema_down (&r->done);
+}
+
+/* Gives BLOCK a request queue, ordered by the policy selected
+   with iosched_select(), and starts the thread that serves it.
+   For a device whose driver makes the caller wait on the
+   hardware. */
+void
+block_start_queue (struct block *block)
+{
+  struct block_queue *q;
+  char name[sizeof block->name + 3];
+
+  ASSERT (block->queue == NULL);
+  q = malloc (sizeof *q);
+  if (q == NULL)
+    PANIC ("Failed to allocate block request queue");
+  q->sched = iosched_current ();
+  lock_init (&q->lock);
+  cond_init (&q->not_empty);
+  list_init (&q->requests);
+  q->head = 0;
+  q->merge_cnt = 0;
+  block->queue = q;
+
+  snprintf (name, sizeof name, "%s-io", block->name);
+  thread_create (name, PRI_MAX, queue_daemon, block);
+}
+
+/* Transfers the CNT sectors starting at SECTOR between BLOCK and
+   BUFFERS, writing if WRITE is true and reading otherwise, and
+   counts the transfer. */
+static void
+transfer (struct block *block, bool write, block_sector_t sector,
+          size_t cnt, void *const buffers[])
+{
+  size_t i;
+
+  if (write)
+    {
+      if (block->ops->writev != NULL)
+        {
+          block->ops->writev (block->aux, sector, cnt,
+                              (const void *const *) buffers);
+          block->write_req_cnt++;
+        }
+      else
+        for (i = 0; i < cnt; i++)
+          {
+            block->ops->write (block->aux, sector + i, buffers[i]);
+            block->write_req_cnt++;
+          }
+      block->write_cnt += cnt;
+    }
+  else
+    {
+      if (block->ops->readv != NULL)
+        {
+          block->ops->readv (block->aux, sector, cnt, buffers);
+          block->read_req_cnt++;
+        }
+      else
+        for (i = 0; i < cnt; i++)
+          {
+            block->ops->read (block->aux, sector + i, buffers[i]);
+            block->read_req_cnt++;
+          }
+      block->read_cnt += cnt;
+    }
+}
+
+/* Removes from Q's requests those that can be merged with FIRST,
+   because they are in the same direction and for the sectors
+   just before or after it or the requests merged with it so far,
+   and adds them to BATCH, which holds FIRST, in order of sector.
+   Stores the range of sectors that BATCH covers in *START and
+   *END.  Q's lock must be held. */
+static void
+merge_requests (struct block_queue *q, struct block_request *first,
+                struct list *batch, block_sector_t *start,
+                block_sector_t *end)
+{
+  bool merged;
+
+  ASSERT (lock_held_by_current_thread (&q->lock));
+  *start = first->sector;
+  *end = first->sector + first->cnt;
+  do
+    {
+      struct list_elem *e;
+
+      merged = false;
+      for (e = list_begin (&q->requests); e != list_end (&q->requests);
+           e = list_next (e))
+        {
+          struct block_request *r = list_entry (e, struct block_request,
+                                                elem);
+
+          if (r->write != first->write || *end - *start + r->cnt > MERGE_MAX)
+            continue;
+          if (r->sector == *end)
+            {
+              list_remove (e);
+              list_push_back (batch, e);
+              *end += r->cnt;
+              merged = true;
+            }
+          else if (r->sector + r->cnt == *start)
+            {
+              list_remove (e);
+              list_push_front (batch, e);
+              *start -= r->cnt;
+              merged = true;
+            }
+          if (merged)
+            {
+              q->merge_cnt++;
+              break;
+            }
+        }
+    }
+  while (merged);
+}
+
+/* Request queue thread for the block device passed as AUX.
+   Serves one request, merged with its neighbors, at a time. */
+static void
+queue_daemon (void *block_)
+{
+  struct block *block = block_;
+  struct block_queue *q = block->queue;
+
+  for (;;)
+    {
+      struct block_request *first;
+      struct list batch;
+      block_sector_t start, end;
+      /* === ADD p4q16 === */
+      int64_t started, finished;
+
+      lock_acquire (&q->lock);
+      while (list_empty (&q->requests))
+        cond_wait (&q->not_empty, &q->lock);
+      first = q->sched->next (&q->requests, q->head);
+      list_remove (&first->elem);
+      list_init (&batch);
+      list_push_back (&batch, &first->elem);
+      merge_requests (q, first, &batch, &start, &end);
+      q->head = end;
+      lock_release (&q->lock);
+
+      /* === ADD p4q16 === */
+      started = timer_usecs ();
+
+      if (list_size (&batch) == 1)
+        transfer (block, first->write, first->sector, first->cnt,
+                  first->buffers);
+      else
+        {
+          struct list_elem *e;
+          size_t n = 0;
+
+          for (e = list_begin (&batch); e != list_end (&batch);
+               e = list_next (e))
+            {
+              struct block_request *r = list_entry (e, struct block_request,
+                                                    elem);
+              size_t i;
+
+              for (i = 0; i < r->cnt; i++)
+                q->buffers[n++] = r->buffers[i];
+            }
+          transfer (block, first->write, start, n, q->buffers);
+        }
+
+      /* A request may disappear as soon as its waiter wakes. */
+      /* === ADD p4q16 === */
+      finished = timer_usecs ();
+      while (!list_empty (&batch))
+        {
+          struct list_elem *e = list_pop_front (&batch);
+          struct block_request *r = list_entry (e, struct block_request,
+                                                elem);
+
+          /* === ADD p4q16 === */
+          count_complete (block, r, started, finished);
+          if (r->origin != block)
+            {
+              /* The partition's driver was bypassed. */
+              if (r->write)
+                {
+                  r->origin->write_cnt += r->cnt;
+                  r->origin->write_req_cnt++;
+                }
+              else
+                {
+                  r->origin->read_cnt += r->cnt;
+                  r->origin->read_req_cnt++;
+                }
+              /* === ADD p4q16 === */
+              count_complete (r->origin, r, started, finished);
+            }
+          sema_up (&r->done);
+        }
+    }
+}
+
+/* Records that BLOCK, a partition, is made of the sectors of
+   PARENT starting at START, so that its requests can be queued
+   at PARENT's queue. */
+void
+block_set_parent (struct block *block, struct block *parent,
+                  block_sector_t start)
+{
+  ASSERT (block->parent == NULL);
+  block->parent = parent;
+  block->start = start;
+}
+
+/* Returns the disk that holds BLOCK, which is BLOCK itself unless
+   it is a partition, and stores in *OFFSET the sector within the
+   disk at which BLOCK starts. */
+static struct block *
+get_disk (struct block *block, block_sector_t *offset)
+{
+  *offset = 0;
+  while (block->parent != NULL)
+    {
+      *offset += block->start;
+      block = block->parent;
+    }
+  return block;
+}
+/* === ADD END p4q15 ===*/
+
+/* === ADD START p4q16 ===*/
+
+/* Counts a request submitted to BLOCK as outstanding. */
+static void
+count_submit (struct block *block)
+{
+  enum intr_level old_level = intr_disable ();
+  if (++block->depth > block->peak_depth)
+    block->peak_depth = block->depth;
+  intr_set_level (old_level);
+}
+
+/* Counts request R, which was outstanding on BLOCK, as complete,
+   having started its transfer at STARTED and finished it at
+   FINISHED. */
+static void
+count_complete (struct block *block, const struct block_request *r,
+                int64_t started, int64_t finished)
+{
+  int64_t latency = finished - r->submitted;
+  enum intr_level old_level;
+  int bucket;
+
+  for (bucket = 0; latency >= 2 && bucket < IOSTAT_HIST_CNT - 1; bucket++)
+    latency >>= 1;
+
+  old_level = intr_disable ();
+  ASSERT (block->depth > 0);
+  block->depth--;
+  block->io_cnt[r->write]++;
+  block->queue_us += started - r->submitted;
+  block->service_us += finished - started;
+  block->hist[bucket]++;
+  intr_set_level (old_level);
+}
+
+/* Stores a snapshot of BLOCK's statistics in *STAT. */
+void
+block_get_stats (struct block *block, struct iostat *stat)
+{
+  enum intr_level old_level;
+
+  strlcpy (stat->name, block->name, sizeof stat->name);
+  strlcpy (stat->role, block_type_name (block->type), sizeof stat->role);
+
+  old_level = intr_disable ();
+  stat->read_reqs = block->io_cnt[false];
+  stat->write_reqs = block->io_cnt[true];
+  stat->read_bytes = block->read_cnt * BLOCK_SECTOR_SIZE;
+  stat->write_bytes = block->write_cnt * BLOCK_SECTOR_SIZE;
+  stat->queue_us = block->queue_us;
+  stat->service_us = block->service_us;
+  stat->depth = block->depth;
+  stat->peak_depth = block->peak_depth;
+  memcpy (stat->hist, block->hist, sizeof stat->hist);
+  intr_set_level (old_level);
+}
+
+/* Prints the request statistics of every block device, with a
+   histogram of request latencies. */
+void
+block_print_iostat (void)
+{
+  struct block *block;
+
+  for (block = block_first (); block != NULL; block = block_next (block))
+    {
+      struct iostat stat;
+      unsigned long long reqs;
+      int i;
+
+      block_get_stats (block, &stat);
+      reqs = stat.read_reqs + stat.write_reqs;
+      printf ("%s (%s): %llu reads (%llu kB), %llu writes (%llu kB)\n",
+              stat.name, stat.role, stat.read_reqs, stat.read_bytes / 1024,
+              stat.write_reqs, stat.write_bytes / 1024);
+      if (reqs == 0)
+        continue;
+      printf ("  average %llu us queued, %llu us in service; "
+              "depth %u, peak %u\n",
+              stat.queue_us / reqs, stat.service_us / reqs,
+              stat.depth, stat.peak_depth);
+      for (i = 0; i < IOSTAT_HIST_CNT; i++)
+        if (stat.hist[i] != 0)
+          printf ("  %8llu us: %llu\n", i == 0 ? 0 : 1ULL << i, stat.hist[i]);
+    }
+}
+/* === ADD END p4q16 ===*/
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
@@ -164,6 +734,8 @@ block_type (struct block *block)
 void
 block_print_stats (void)
 {
+  /* === ADD p4q15 === */
+  struct block *block;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -171,11 +743,23 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
-          printf ("%s (%s): %llu reads, %llu writes\n",
+          /* === MODIFY START p4q13 ===*/
+          printf ("%s (%s): %llu reads in %llu requests, "
+                  "%llu writes in %llu requests\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  block->read_cnt, block->read_req_cnt,
+                  block->write_cnt, block->write_req_cnt);
+          /* === MODIFY END p4q13 ===*/
         }
     }
+
+  /* === ADD START p4q15 ===*/
+  for (block = block_first (); block != NULL; block = block_next (block))
+    if (block->queue != NULL)
+      printf ("%s: %s scheduler, %llu requests merged\n",
+              block->name, block->queue->sched->name,
+              block->queue->merge_cnt);
+  /* === ADD END p4q15 ===*/
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -200,6 +784,21 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  /* === ADD START p4q13 ===*/
+  block->read_req_cnt = 0;
+  block->write_req_cnt = 0;
+  /* === ADD END p4q13 ===*/
+  /* === ADD START p4q15 ===*/
+  block->queue = NULL;
+  block->parent = NULL;
+  block->start = 0;
+  /* === ADD END p4q15 ===*/
+  /* === ADD START p4q16 ===*/
+  block->io_cnt[0] = block->io_cnt[1] = 0;
+  block->queue_us = block->service_us = 0;
+  block->depth = block->peak_depth = 0;
+  memset (block->hist, 0, sizeof block->hist);
+  /* === ADD END p4q16 ===*/
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -3,6 +3,11 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+/* === ADD START p4q15 ===*/
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+/* === ADD END p4q15 ===*/
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,11 +58,48 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+/* === ADD START p4q13 ===*/
+void block_read_multi (struct block *, block_sector_t, size_t cnt, void *);
+void block_write_multi (struct block *, block_sector_t, size_t cnt,
+                        const void *);
+void block_readv (struct block *, block_sector_t, size_t cnt,
+                  void *const buffers[]);
+void block_writev (struct block *, block_sector_t, size_t cnt,
+                   const void *const buffers[]);
+/* === ADD END p4q13 ===*/
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* === ADD START p4q15 ===*/
+/* An asynchronous request to transfer a run of sectors. */
+struct block_request
+  {
+    struct list_elem elem;              /* Element in device's queue. */
+    bool write;                         /* Write, not read? */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    void *const *buffers;               /* One buffer per sector. */
+    int64_t deadline;                   /* Tick to be served by. */
+    struct semaphore done;              /* Up'd when complete. */
+    struct block *origin;               /* Device submitted to. */
+    /* === ADD p4q16 === */
+    int64_t submitted;                  /* Time submitted, in us. */
+  };
+
+void block_request_init (struct block_request *, bool write,
+                         block_sector_t, size_t cnt,
+                         void *const buffers[]);
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+/* === ADD END p4q15 ===*/
+
 /* Statistics. */
 void block_print_stats (void);
+/* === ADD START p4q16 ===*/
+struct iostat;
+void block_get_stats (struct block *, struct iostat *);
+void block_print_iostat (void);
+/* === ADD END p4q16 ===*/
 
 /* Lower-level interface to block device drivers. */
 
@@ -65,10 +107,24 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+    /* === ADD START p4q13 ===*/
+    /* Transfer CNT consecutive sectors, the Ith of them to or from
+       BUFFERS[I], as one request.  Optional: if null, the block
+       layer calls READ or WRITE once per sector instead. */
+    void (*readv) (void *aux, block_sector_t, size_t cnt,
+                   void *const buffers[]);
+    void (*writev) (void *aux, block_sector_t, size_t cnt,
+                    const void *const buffers[]);
+    /* === ADD END p4q13 ===*/
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+/* === ADD START p4q15 ===*/
+void block_start_queue (struct block *);
+void block_set_parent (struct block *, struct block *parent,
+                       block_sector_t start);
+/* === ADD END p4q15 ===*/
 
 #endif /* devices/block.h */
@@ -3,16 +3,40 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+/* === ADD p4q14 === */
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+/* === ADD START p4q14 ===*/
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+/* === ADD END p4q14 ===*/
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
 
+/* === ADD START p4q14 ===*/
+/* With -dma, transfers use bus-master DMA when the PCI IDE
+   controller and the disk support it: the controller moves the
+   data to or from memory on its own, following a table of
+   physical region descriptors, and interrupts once at the end,
+   so the CPU is free to run other threads meanwhile.  Otherwise,
+   transfers use PIO, in which the CPU copies every word through
+   the data register; a disk that supports READ/WRITE MULTIPLE
+   then interrupts once per block of sectors instead of once per
+   sector.  A DMA transfer that fails is retried with PIO, which
+   the disk then keeps using. */
+
+/* Use DMA if possible?  Off unless the -dma kernel command-line
+   option is given, because the DMA path has not yet been run
+   against the test suites. */
+bool ide_use_dma = false;
+/* === ADD END p4q14 ===*/
+
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
 #define reg_error(CHANNEL) ((CHANNEL)->reg_base + 1)    /* Error. */
@@ -34,6 +58,8 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+/* === ADD p4q14 === */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -50,6 +76,55 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
+/* === ADD START p4q14 ===*/
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+/* === ADD END p4q14 ===*/
+
+/* === ADD START p4q13 ===*/
+/* Most sectors one READ SECTOR or WRITE SECTOR command can
+   transfer. */
+#define MAX_SECTORS_PER_CMD 256
+/* === ADD END p4q13 ===*/
+
+/* === ADD START p4q14 ===*/
+/* Most sectors per interrupt that we ask of READ/WRITE MULTIPLE. */
+#define MAX_MULTIPLE 16
+
+/* Bus-master IDE port addresses, relative to the channel's
+   bus-master base. */
+#define bm_command(CHANNEL) ((CHANNEL)->bm_base + 0)    /* Command. */
+#define bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)     /* Status. */
+#define bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)       /* PRD table. */
+
+/* Bus-master Command Register bits. */
+#define BM_START 0x01           /* Start transfer. */
+#define BM_READ 0x08            /* Transfer from disk to memory. */
+
+/* Bus-master Status Register bits. */
+#define BM_STA_ERR 0x02         /* Error, write 1 to clear. */
+#define BM_STA_INTR 0x04        /* Interrupt, write 1 to clear. */
+
+/* PCI configuration space access, for finding the controller. */
+#define PCI_CONFIG_ADDRESS 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* A physical region descriptor: one piece of memory, which may
+   not cross a 64 kB boundary, for the controller to transfer. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Bytes, with 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT in the last entry. */
+  };
+
+#define PRD_EOT 0x8000          /* End of table. */
+#define PRD_CNT (PGSIZE / sizeof (struct prd))
+/* === ADD END p4q14 ===*/
+
 /* An ATA device. */
 struct ata_disk
   {
@@ -57,6 +132,10 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    /* === ADD START p4q14 ===*/
+    bool dma;                   /* Transfer with DMA? */
+    size_t multiple_cnt;        /* Sectors per interrupt in PIO. */
+    /* === ADD END p4q14 ===*/
   };
 
 /* An ATA channel (aka controller).
@@ -71,6 +150,10 @@ struct channel
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    /* === ADD START p4q14 ===*/
+    uint16_t bm_base;           /* Bus-master base port, 0 if none. */
+    struct prd *prdt;           /* PRD table, one page. */
+    /* === ADD END p4q14 ===*/
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -85,7 +168,8 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+/* === MODIFY p4q13 === */
+static void select_sectors (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -96,12 +180,28 @@ static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+/* === ADD START p4q13 ===*/
+static void ide_readv (void *, block_sector_t, size_t,
+                       void *const buffers[]);
+static void ide_writev (void *, block_sector_t, size_t,
+                        const void *const buffers[]);
+/* === ADD END p4q13 ===*/
+/* === ADD START p4q14 ===*/
+static uint16_t find_bus_master (void);
+static void set_multiple_mode (struct ata_disk *, size_t max);
+static bool build_prdt (struct channel *, size_t cnt,
+                        const void *const buffers[]);
+static bool dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          bool write);
+/* === ADD END p4q14 ===*/
 
 /* Initialize the disk subsystem and detect disks. */
 void
 ide_init (void) 
 {
   size_t chan_no;
+  /* === ADD p4q14 === */
+  uint16_t bm_base = ide_use_dma ? find_bus_master () : 0;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
@@ -126,6 +226,16 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      /* === ADD START p4q14 ===*/
+      c->bm_base = 0;
+      c->prdt = NULL;
+      if (bm_base != 0)
+        {
+          c->prdt = palloc_get_page (0);
+          if (c->prdt != NULL)
+            c->bm_base = bm_base + chan_no * 8;
+        }
+      /* === ADD END p4q14 ===*/
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +246,10 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          /* === ADD START p4q14 ===*/
+          d->dma = false;
+          d->multiple_cnt = 1;
+          /* === ADD END p4q14 ===*/
         }
 
       /* Register interrupt handler. */
@@ -289,6 +403,14 @@ identify_ata_device (struct ata_disk *d)
   snprintf (extra_info, sizeof extra_info,
             "model \"%s\", serial \"%s\"", model, serial);
 
+  /* === ADD START p4q14 ===*/
+  /* Word 49 bit 8 says whether the disk can do DMA, and the low
+     byte of word 47 is the most sectors per interrupt it allows
+     for READ/WRITE MULTIPLE. */
+  d->dma = c->bm_base != 0 && (*(uint16_t *) &id[49 * 2] & 0x100) != 0;
+  set_multiple_mode (d, *(uint16_t *) &id[47 * 2] & 0xff);
+  /* === ADD END p4q14 ===*/
+
   /* Disable access to IDE disks over 1 GB, which are likely
      physical IDE disks rather than virtual ones.  If we don't
      allow access to those, we're less likely to scribble on
@@ -303,9 +425,16 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* === ADD START p4q14 ===*/
+  if (d->dma)
+    strlcat (extra_info, ", DMA", sizeof extra_info);
+  /* === ADD END p4q14 ===*/
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
+  /* === ADD p4q15 === */
+  block_start_queue (block);
   partition_scan (block);
 }
 
@@ -344,16 +473,8 @@ descramble_ata_string (char *string, int size)
 static void
 ide_read (void *d_, block_sector_t sec_no, void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  lock_release (&c->lock);
+  /* === MODIFY p4q13 === */
+  ide_readv (d_, sec_no, 1, &buffer);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -363,43 +484,151 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
    per-disk locking is unneeded. */
 static void
 ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+{
+  /* === MODIFY p4q13 === */
+  ide_writev (d_, sec_no, 1, &buffer);
+}
+
+/* === ADD START p4q13 ===*/
+/* === MODIFY START p4q14 ===*/
+/* Reads the N sectors starting at SEC_NO from disk D with PIO,
+   the Ith of them into BUFFERS[I].  The disk interrupts once for
+   each block of sectors that is ready to be read.  D's channel
+   must be locked. */
+static void
+pio_read (struct ata_disk *d, block_sector_t sec_no, size_t n,
+          void *const buffers[])
+{
+  struct channel *c = d->channel;
+  size_t per_intr = d->multiple_cnt;
+  size_t i, j;
+
+  select_sectors (d, sec_no, n);
+  issue_pio_command (c, per_intr > 1 ? CMD_READ_MULTIPLE
+                                     : CMD_READ_SECTOR_RETRY);
+  for (i = 0; i < n; i += per_intr)
+    {
+      sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu,
+               d->name, sec_no + i);
+      for (j = i; j < n && j < i + per_intr; j++)
+        input_sector (c, buffers[j]);
+    }
+}
+
+/* Writes the N sectors starting at SEC_NO to disk D with PIO,
+   the Ith of them from BUFFERS[I].  The disk interrupts once it
+   has taken each block of sectors.  D's channel must be
+   locked. */
+static void
+pio_write (struct ata_disk *d, block_sector_t sec_no, size_t n,
+           const void *const buffers[])
+{
+  struct channel *c = d->channel;
+  size_t per_intr = d->multiple_cnt;
+  size_t i, j;
+
+  select_sectors (d, sec_no, n);
+  issue_pio_command (c, per_intr > 1 ? CMD_WRITE_MULTIPLE
+                                     : CMD_WRITE_SECTOR_RETRY);
+  for (i = 0; i < n; i += per_intr)
+    {
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu,
+               d->name, sec_no + i);
+      for (j = i; j < n && j < i + per_intr; j++)
+        output_sector (c, buffers[j]);
+      sema_down (&c->completion_wait);
+    }
+}
+
+/* Reads the CNT sectors starting at SEC_NO from disk D, the Ith
+   of them into BUFFERS[I], issuing one command per
+   MAX_SECTORS_PER_CMD sectors.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_readv (void *d_, block_sector_t sec_no, size_t cnt,
+           void *const buffers[])
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+
+      if (!d->dma || !build_prdt (c, n, (const void *const *) buffers)
+          || !dma_transfer (d, sec_no, n, false))
+        pio_read (d, sec_no, n, buffers);
+      sec_no += n;
+      buffers += n;
+      cnt -= n;
+    }
+  lock_release (&c->lock);
+}
+
+/* Writes the CNT sectors starting at SEC_NO to disk D, the Ith of
+   them from BUFFERS[I], issuing one command per
+   MAX_SECTORS_PER_CMD sectors.  Returns after the disk has
+   acknowledged receiving all of the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_writev (void *d_, block_sector_t sec_no, size_t cnt,
+            const void *const buffers[])
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  lock_acquire (&c->lock);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+
+      if (!d->dma || !build_prdt (c, n, buffers)
+          || !dma_transfer (d, sec_no, n, true))
+        pio_write (d, sec_no, n, buffers);
+      sec_no += n;
+      buffers += n;
+      cnt -= n;
+    }
   lock_release (&c->lock);
 }
+/* === MODIFY END p4q14 ===*/
+/* === ADD END p4q13 ===*/
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    /* === MODIFY START p4q13 ===*/
+    ide_write,
+    ide_readv,
+    ide_writev
+    /* === MODIFY END p4q13 ===*/
   };
-
+
+/* === MODIFY START p4q13 ===*/
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT, the number of sectors to transfer, to
+   the disk's sector selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sectors (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_SECTORS_PER_CMD);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);            /* 256 is written as 0. */
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
   outb (reg_device (c),
         DEV_MBS | DEV_LBA | (d->dev_no == 1 ? DEV_DEV : 0) | (sec_no >> 24));
 }
+/* === MODIFY END p4q13 ===*/
 
 /* Writes COMMAND to channel C and prepares for receiving a
    completion interrupt. */
@@ -430,6 +659,175 @@ output_sector (struct channel *c, const void *sector)
   outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
 }
 
+/* === ADD START p4q14 ===*/
+/* Bus-master DMA. */
+
+/* Reads the 32-bit register at byte offset REG of the
+   configuration space of PCI function FUNC of device DEV on bus
+   0. */
+static uint32_t
+pci_read_config (int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDRESS, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to the 32-bit register at byte offset REG of the
+   configuration space of PCI function FUNC of device DEV on bus
+   0. */
+static void
+pci_write_config (int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDRESS, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for a bus-master IDE controller that uses
+   the legacy channel ports, such as the PIIX's, and enables it.
+   Returns the base port of its bus-master registers, or 0 if
+   there is none. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t class, bar4;
+
+        if ((pci_read_config (dev, func, 0x00) & 0xffff) == 0xffff)
+          continue;
+
+        /* Class 1, subclass 1 is an IDE controller.  Bit 7 of its
+           programming interface says it can be a bus master, and
+           bits 0 and 2 that a channel uses its own ports instead
+           of the legacy ones. */
+        class = pci_read_config (dev, func, 0x08) >> 8;
+        if ((class >> 8) != 0x0101 || (class & 0x85) != 0x80)
+          continue;
+
+        /* BAR 4 holds the bus-master registers' I/O ports. */
+        bar4 = pci_read_config (dev, func, 0x20);
+        if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space access and bus mastering. */
+        pci_write_config (dev, func, 0x04,
+                          pci_read_config (dev, func, 0x04) | 0x05);
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
+/* Asks disk D to transfer as many sectors per interrupt as
+   possible for READ/WRITE MULTIPLE, given that it allows at most
+   MAX, and records the number it agrees to. */
+static void
+set_multiple_mode (struct ata_disk *d, size_t max)
+{
+  struct channel *c = d->channel;
+  size_t cnt;
+
+  /* The count must be a power of 2. */
+  for (cnt = MAX_MULTIPLE; cnt > max; cnt /= 2)
+    continue;
+  d->multiple_cnt = 1;
+  if (cnt < 2)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), cnt);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+    d->multiple_cnt = cnt;
+}
+
+/* Fills in channel C's PRD table for transferring the CNT
+   sectors in BUFFERS.  Buffers that are adjacent in memory share
+   a descriptor.  Returns false if the buffers cannot be
+   transferred with DMA, because one is not in kernel memory or
+   is at an odd address. */
+static bool
+build_prdt (struct channel *c, size_t cnt, const void *const buffers[])
+{
+  struct prd *prd = NULL;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      uint32_t addr, size;
+
+      if (!is_kernel_vaddr (buffers[i]) || ((uintptr_t) buffers[i] & 1))
+        return false;
+      addr = vtop (buffers[i]);
+      for (size = BLOCK_SECTOR_SIZE; size > 0; )
+        {
+          /* A descriptor may not cross a 64 kB boundary. */
+          uint32_t room = 0x10000 - (addr & 0xffff);
+          uint32_t n = size < room ? size : room;
+
+          if (prd != NULL && prd->addr + (prd->size ? prd->size : 0x10000)
+                             == addr
+              && (addr & 0xffff) != 0)
+            prd->size += n;
+          else
+            {
+              prd = prd == NULL ? c->prdt : prd + 1;
+              ASSERT (prd < c->prdt + PRD_CNT);
+              prd->addr = addr;
+              prd->size = n;
+              prd->flags = 0;
+            }
+          addr += n;
+          size -= n;
+        }
+    }
+  prd->flags = PRD_EOT;
+  return true;
+}
+
+/* Transfers the N sectors starting at SEC_NO between disk D and
+   the buffers described by its channel's PRD table, reading from
+   the disk unless WRITE is true.  The channel must be locked.
+   Returns true if successful.  On failure, turns off DMA for D,
+   so that the caller and later transfers use PIO. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t n,
+              bool write)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = write ? 0 : BM_READ;
+  uint8_t bm, status;
+
+  outl (bm_prdt (c), vtop (c->prdt));
+  outb (bm_command (c), direction);
+  outb (bm_status (c), inb (bm_status (c)) | BM_STA_ERR | BM_STA_INTR);
+
+  select_sectors (d, sec_no, n);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  barrier ();
+  outb (bm_command (c), direction | BM_START);
+  sema_down (&c->completion_wait);
+  outb (bm_command (c), direction);
+  barrier ();
+
+  bm = inb (bm_status (c));
+  outb (bm_status (c), bm | BM_STA_ERR | BM_STA_INTR);
+  status = inb (reg_alt_status (c));
+  if ((bm & BM_STA_ERR) == 0
+      && (status & (STA_BSY | STA_DRQ | STA_ERR)) == 0)
+    return true;
+
+  printf ("%s: DMA %s failed, sector=%"PRDSNu", using PIO\n",
+          d->name, write ? "write" : "read", sec_no);
+  d->dma = false;
+  return false;
+}
+/* === ADD END p4q14 ===*/
+
 /* Low-level ATA primitives. */
 
 /* Wait up to 10 seconds for the controller to become idle, that
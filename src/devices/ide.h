@@ -1,6 +1,12 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+/* === ADD START p4q14 ===*/
+#include <stdbool.h>
+
+extern bool ide_use_dma;
+/* === ADD END p4q14 ===*/
+
 void ide_init (void);
 
 #endif /* devices/ide.h */
@@ -0,0 +1,105 @@
+/* === ADD START p4q15 ===*/
+#include "devices/iosched.h"
+#include <debug.h>
+#include <string.h>
+#include "devices/timer.h"
+
+/* Block request ordering policies.
+
+   "fifo" serves requests in the order they arrive.
+
+   "clook" (circular LOOK) sweeps the disk in one direction: it
+   serves the request with the lowest sector at or after the end
+   of the last one, and once there is none, starts over from the
+   lowest sector queued.  This keeps seeks short and, unlike
+   always taking the nearest request, cannot leave a request
+   behind for as long as others keep arriving near the head.
+
+   "deadline", the default, is C-LOOK, except that a request that
+   has waited past its deadline is served first.  Reads, which
+   someone is usually waiting for, get a shorter deadline than
+   writes; see block_submit(). */
+
+/* Returns the first request in QUEUE. */
+static struct block_request *
+fifo_next (struct list *queue, block_sector_t head UNUSED)
+{
+  return list_entry (list_front (queue), struct block_request, elem);
+}
+
+/* Returns the request in QUEUE with the lowest sector at or
+   after HEAD, or the lowest sector overall if there is none. */
+static struct block_request *
+clook_next (struct list *queue, block_sector_t head)
+{
+  struct block_request *ahead = NULL;   /* Lowest at or after HEAD. */
+  struct block_request *lowest = NULL;  /* Lowest overall. */
+  struct list_elem *e;
+
+  for (e = list_begin (queue); e != list_end (queue); e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+
+      if (r->sector >= head && (ahead == NULL || r->sector < ahead->sector))
+        ahead = r;
+      if (lowest == NULL || r->sector < lowest->sector)
+        lowest = r;
+    }
+  return ahead != NULL ? ahead : lowest;
+}
+
+/* Returns the request in QUEUE with the earliest deadline if
+   that deadline has passed, otherwise the request that C-LOOK
+   would choose. */
+static struct block_request *
+deadline_next (struct list *queue, block_sector_t head)
+{
+  struct block_request *earliest = NULL;
+  struct list_elem *e;
+
+  for (e = list_begin (queue); e != list_end (queue); e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+
+      if (earliest == NULL || r->deadline < earliest->deadline)
+        earliest = r;
+    }
+  if (earliest->deadline <= timer_ticks ())
+    return earliest;
+  return clook_next (queue, head);
+}
+
+static const struct iosched fifo = { "fifo", fifo_next };
+static const struct iosched clook = { "clook", clook_next };
+static const struct iosched deadline = { "deadline", deadline_next };
+
+static const struct iosched *scheds[] = { &deadline, &clook, &fifo };
+#define SCHED_CNT (sizeof scheds / sizeof *scheds)
+
+/* Policy for devices whose queues start from now on. */
+static const struct iosched *current = &deadline;
+
+/* Selects the policy with the given NAME for block devices whose
+   request queues start from now on.  Returns true if successful,
+   false if there is no such policy. */
+bool
+iosched_select (const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < SCHED_CNT; i++)
+    if (!strcmp (name, scheds[i]->name))
+      {
+        current = scheds[i];
+        return true;
+      }
+  return false;
+}
+
+/* Returns the selected policy. */
+const struct iosched *
+iosched_current (void)
+{
+  return current;
+}
+/* === ADD END p4q15 ===*/
@@ -0,0 +1,25 @@
+/* === ADD START p4q15 ===*/
+#ifndef DEVICES_IOSCHED_H
+#define DEVICES_IOSCHED_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* An ordering policy for the requests queued for a block device. */
+struct iosched
+  {
+    const char *name;                   /* Name, e.g. "clook". */
+
+    /* Returns the request in QUEUE, which must not be empty, to
+       serve next, given that the last request served ended just
+       before sector HEAD.  Does not remove it from QUEUE. */
+    struct block_request *(*next) (struct list *queue,
+                                   block_sector_t head);
+  };
+
+bool iosched_select (const char *name);
+const struct iosched *iosched_current (void);
+
+#endif /* devices/iosched.h */
+/* === ADD END p4q15 ===*/
@@ -181,7 +181,11 @@ found_partition (struct block *block, uint8_t part_type,
       snprintf (name, sizeof name, "%s%d", block_name (block), part_nr);
       snprintf (extra_info, sizeof extra_info, "%s (%02x)",
                 partition_type_name (part_type), part_type);
-      block_register (name, type, extra_info, size, &partition_operations, p);
+      /* === MODIFY START p4q15 ===*/
+      block_set_parent (block_register (name, type, extra_info, size,
+                                        &partition_operations, p),
+                        block, start);
+      /* === MODIFY END p4q15 ===*/
     }
 }
 
@@ -317,8 +321,34 @@ partition_write (void *p_, block_sector_t sector, const void *buffer)
   block_write (p->block, p->start + sector, buffer);
 }
 
+/* === ADD START p4q13 ===*/
+/* Reads the CNT sectors starting at SECTOR from partition P, the
+   Ith of them into BUFFERS[I], as one request to the disk. */
+static void
+partition_readv (void *p_, block_sector_t sector, size_t cnt,
+                 void *const buffers[])
+{
+  struct partition *p = p_;
+  block_readv (p->block, p->start + sector, cnt, buffers);
+}
+
+/* Writes the CNT sectors starting at SECTOR to partition P, the
+   Ith of them from BUFFERS[I], as one request to the disk. */
+static void
+partition_writev (void *p_, block_sector_t sector, size_t cnt,
+                  const void *const buffers[])
+{
+  struct partition *p = p_;
+  block_writev (p->block, p->start + sector, cnt, buffers);
+}
+/* === ADD END p4q13 ===*/
+
 static struct block_operations partition_operations =
   {
     partition_read,
-    partition_write
+    /* === MODIFY START p4q13 ===*/
+    partition_write,
+    partition_readv,
+    partition_writev
+    /* === MODIFY END p4q13 ===*/
   };
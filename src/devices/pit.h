@@ -3,6 +3,13 @@
 
 #include <stdint.h>
 
+/* === ADD START p4q16 ===*/
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+/* === ADD END p4q16 ===*/
+
 void pit_configure_channel (int channel, int mode, int frequency);
+/* === ADD p4q16 === */
+uint16_t pit_read_counter (int channel);
 
 #endif /* devices/pit.h */
@@ -0,0 +1,125 @@
+/* === ADD START p4q17 ===*/
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* RAM disks.
+
+   A RAM disk is a block device whose sectors are kept in kernel
+   memory, so that its transfers cost a memcpy() and nothing
+   else.  Running the file system or swap on one measures the
+   software above the block layer without the disk in the way.
+   Its contents do not outlive the machine, so a file system on a
+   RAM disk must be formatted at every boot.
+
+   The sectors are kept in pages allocated one at a time, so that
+   a large RAM disk does not need contiguous memory. */
+
+/* Sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    size_t page_cnt;                    /* Number of pages. */
+    uint8_t **pages;                    /* The pages holding the data. */
+  };
+
+static struct block_operations ramdisk_operations;
+
+/* Number of RAM disks created, for naming them. */
+static int ramdisk_cnt;
+
+/* Creates and registers a RAM disk of SIZE sectors, all zeros,
+   of the given TYPE, and returns it.  Panics if there is not
+   enough kernel memory. */
+struct block *
+ramdisk_create (enum block_type type, block_sector_t size)
+{
+  struct ramdisk *rd;
+  char name[16];
+  size_t i;
+
+  ASSERT (size > 0);
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    PANIC ("Failed to allocate RAM disk descriptor");
+  rd->page_cnt = DIV_ROUND_UP (size, SECTORS_PER_PAGE);
+  rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    PANIC ("Failed to allocate RAM disk page table");
+  for (i = 0; i < rd->page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        PANIC ("Out of kernel memory for RAM disk (%zu of %zu pages)",
+               i, rd->page_cnt);
+    }
+
+  snprintf (name, sizeof name, "ram%d", ramdisk_cnt++);
+  return block_register (name, type, "RAM disk", size,
+                         &ramdisk_operations, rd);
+}
+
+/* Returns the address of SECTOR in RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER, which must
+   have room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  memcpy (buffer, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER, which must
+   contain BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  memcpy (sector_addr (rd, sector), buffer, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads the CNT sectors starting at SECTOR from RAM disk RD, the
+   Ith of them into BUFFERS[I]. */
+static void
+ramdisk_readv (void *rd, block_sector_t sector, size_t cnt,
+               void *const buffers[])
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    ramdisk_read (rd, sector + i, buffers[i]);
+}
+
+/* Writes the CNT sectors starting at SECTOR to RAM disk RD, the
+   Ith of them from BUFFERS[I]. */
+static void
+ramdisk_writev (void *rd, block_sector_t sector, size_t cnt,
+                const void *const buffers[])
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    ramdisk_write (rd, sector + i, buffers[i]);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_readv,
+    ramdisk_writev,
+  };
+/* === ADD END p4q17 ===*/
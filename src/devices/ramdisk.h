@@ -0,0 +1,10 @@
+/* === ADD START p4q17 ===*/
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include "devices/block.h"
+
+struct block *ramdisk_create (enum block_type, block_sector_t size);
+
+#endif /* devices/ramdisk.h */
+/* === ADD END p4q17 ===*/
@@ -9,9 +9,23 @@
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
+/* === ADD START p4q23 ===*/
+#ifdef VM
+#include "vm/frame.h"
+#endif
+/* === ADD END p4q23 ===*/
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
+/* === ADD START p4q1 ===*/
+#include "filesys/cache.h"
+/* === ADD END p4q1 ===*/
+/* === ADD p4q6 === */
+#include "filesys/inode.h"
+/* === ADD p4q8 === */
+#include "filesys/name-cache.h"
+/* === ADD p4q12 === */
+#include "filesys/journal.h"
 #endif
 
 /* Keyboard control register port. */
@@ -132,10 +146,24 @@ print_stats (void)
   thread_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  /* === ADD START p4q1 ===*/
+  cache_print_stats ();
+  /* === ADD END p4q1 ===*/
+  /* === ADD p4q6 === */
+  inode_print_stats ();
+  /* === ADD p4q8 === */
+  name_cache_print_stats ();
+  /* === ADD p4q12 === */
+  journal_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+  /* === ADD START p4q23 ===*/
+#ifdef VM
+  frame_print_stats ();
+#endif
+  /* === ADD END p4q23 ===*/
 }
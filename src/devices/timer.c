@@ -76,6 +76,32 @@ timer_ticks (void)
   return t;
 }
 
+/* === ADD START p4q16 ===*/
+/* Returns the number of microseconds since the OS booted, at a
+   finer grain than timer_ticks() by also reading how far the PIT
+   has counted toward the next tick. */
+int64_t
+timer_usecs (void)
+{
+  static int64_t last;
+  enum intr_level old_level;
+  int64_t cycles, us;
+  int reload = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
+
+  old_level = intr_disable ();
+  cycles = reload - pit_read_counter (0);
+  us = ticks * (1000 * 1000 / TIMER_FREQ) + cycles * 1000 * 1000 / PIT_HZ;
+
+  /* The counter may have wrapped before the tick was counted, so
+     never go backward. */
+  if (us < last)
+    us = last;
+  last = us;
+  intr_set_level (old_level);
+  return us;
+}
+/* === ADD END p4q16 ===*/
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
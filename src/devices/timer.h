@@ -12,6 +12,8 @@ void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+/* === ADD p4q16 === */
+int64_t timer_usecs (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -0,0 +1,40 @@
+/* iostat.c
+
+   Prints each block device's request counts, average queue and
+   service times, and request latency histogram. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+/* Most devices reported. */
+#define MAX_DEVICES 16
+
+int
+main (void) 
+{
+  static struct iostat stats[MAX_DEVICES];
+  int cnt = iostat (stats, MAX_DEVICES);
+  int i, j;
+
+  if (cnt > MAX_DEVICES)
+    cnt = MAX_DEVICES;
+  for (i = 0; i < cnt; i++) 
+    {
+      struct iostat *s = &stats[i];
+      unsigned long long reqs = s->read_reqs + s->write_reqs;
+
+      printf ("%s (%s): %llu reads (%llu kB), %llu writes (%llu kB)\n",
+              s->name, s->role, s->read_reqs, s->read_bytes / 1024,
+              s->write_reqs, s->write_bytes / 1024);
+      if (reqs == 0)
+        continue;
+      printf ("  average %llu us queued, %llu us in service; "
+              "depth %u, peak %u\n",
+              s->queue_us / reqs, s->service_us / reqs,
+              s->depth, s->peak_depth);
+      for (j = 0; j < IOSTAT_HIST_CNT; j++)
+        if (s->hist[j] != 0)
+          printf ("  %8llu us: %llu\n", j == 0 ? 0 : 1ULL << j, s->hist[j]);
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,661 @@
+/* === ADD START p4q1 ===*/
+#include "filesys/cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+/* === ADD START p4q3 ===*/
+#include "devices/timer.h"
+/* === ADD END p4q3 ===*/
+/* === ADD p4q12 === */
+#include "filesys/journal.h"
+
+/* Buffer cache.
+
+   Holds CACHE_SIZE sectors of the file system device in memory.
+   Writes are absorbed by the cache and only reach the disk when
+   an entry is evicted or cache_flush() is called.  Entries are
+   replaced with the clock (second chance) algorithm.
+
+   Synchronization: CACHE_LOCK protects the mapping from entries
+   to sectors, the accessed bits, the pin counts and the clock
+   hand.  Each entry's own lock protects its data and dirty bit,
+   and is held by a thread for as long as it is copying data in
+   or out of the entry.  A thread that wants an entry first pins
+   it under CACHE_LOCK, so an entry with a pin count of 0 is
+   never locked and may be chosen for eviction.
+
+   A dirty victim is written back with CACHE_LOCK released, so
+   that other threads' lookups do not wait for the disk.  While
+   that write is in progress the entry is marked EVICTING: it
+   still holds its old sector, and a lookup of that sector waits
+   until the write is done and then looks again, rather than
+   reading the stale copy on disk. */
+
+/* === ADD START p4q12 ===*/
+/* Metadata.
+
+   Writes of metadata are handed to the journal, which from then
+   on writes the sector to disk, so the entry stays clean.  A miss
+   reads a sector through the journal, which supplies its newest
+   contents if an earlier copy was dropped from the cache before
+   the journal wrote it home. */
+/* === ADD END p4q12 ===*/
+
+/* === ADD START p4q3 ===*/
+/* Write-behind.
+
+   Dirty entries are written back by the "write-behind" thread,
+   once a second and whenever the number of dirty entries reaches
+   cache_dirty_high.  A writer that finds more than halfway
+   between that mark and a cache full of dirty entries waits for
+   the write-behind thread to catch up, so that writers cannot
+   outrun the disk and leave no clean entries to evict. */
+
+/* Ticks between periodic write-behind passes. */
+#define WRITE_BEHIND_INTERVAL TIMER_FREQ
+
+/* Dirty entries that start a write-behind pass.  May be set with
+   the -dirty kernel command-line option. */
+size_t cache_dirty_high = CACHE_SIZE / 2;
+/* === ADD END p4q3 ===*/
+
+/* A cached sector. */
+struct cache_entry
+  {
+    block_sector_t sector;              /* Sector held, if valid. */
+    bool valid;                         /* Does SECTOR mean anything? */
+    bool accessed;                      /* Used since last clock sweep? */
+    int pin_cnt;                        /* Threads using or awaiting us. */
+    bool evicting;                      /* Being written back for reuse? */
+
+    struct lock lock;                   /* Protects DIRTY and DATA. */
+    bool dirty;                         /* Must DATA be written back? */
+    uint8_t *data;                      /* BLOCK_SECTOR_SIZE bytes. */
+  };
+
+static struct cache_entry cache[CACHE_SIZE];
+static struct lock cache_lock;
+/* === ADD p4q15 === */
+static struct lock flush_lock;          /* One cache_flush() at a time. */
+static struct condition cache_unpinned; /* Signaled when a pin drops. */
+static struct condition evicted;        /* Signaled when EVICTING clears. */
+static size_t clock_hand;
+
+/* Statistics. */
+static unsigned long long hit_cnt;      /* Lookups satisfied in memory. */
+static unsigned long long miss_cnt;     /* Lookups that had to load. */
+/* === ADD START p4q2 ===*/
+static unsigned long long read_ahead_cnt; /* Sectors loaded ahead. */
+
+/* Read-ahead requests, consumed by the read-ahead thread.
+   Requests that do not fit are dropped: read-ahead is only a
+   hint. */
+#define READ_AHEAD_QUEUE 64
+static block_sector_t read_ahead_queue[READ_AHEAD_QUEUE];
+static size_t read_ahead_head;          /* Next request to serve. */
+static size_t read_ahead_queued;        /* Requests in the queue. */
+static struct lock read_ahead_lock;
+static struct condition read_ahead_ready;
+/* === ADD END p4q2 ===*/
+
+/* === ADD START p4q3 ===*/
+static size_t dirty_cnt;                /* Dirty entries. */
+static bool flush_due;                  /* Periodic pass requested? */
+static struct condition flush_needed;   /* Wakes the write-behind thread. */
+static struct condition dirty_below_limit; /* Wakes throttled writers. */
+static unsigned long long throttle_cnt; /* Writes that had to wait. */
+
+static void write_behind_daemon (void *aux);
+static void flush_timer_daemon (void *aux);
+static void throttle_writer (void);
+static size_t dirty_limit (void);
+/* === ADD END p4q3 ===*/
+/* === ADD START p4q2 ===*/
+
+static void read_ahead_daemon (void *aux);
+/* === ADD END p4q2 ===*/
+
+/* === ADD p4q13 === */
+static struct cache_entry *lookup (block_sector_t);
+static struct cache_entry *cache_get (block_sector_t, bool fill);
+/* === ADD START p4q2 ===*/
+static struct cache_entry *cache_load (block_sector_t, bool fill);
+/* === ADD END p4q2 ===*/
+static void cache_put (struct cache_entry *, bool dirty);
+/* === ADD START p4q12 ===*/
+static void write_at (block_sector_t, const void *, int ofs, int size,
+                      bool metadata);
+/* === ADD END p4q12 ===*/
+/* === ADD START p4q3 ===*/
+static void cache_unpin (struct cache_entry *, int dirty_change);
+/* === ADD END p4q3 ===*/
+
+/* Initializes the buffer cache. */
+void
+cache_init (void)
+{
+  size_t per_page = PGSIZE / BLOCK_SECTOR_SIZE;
+  uint8_t *pages;
+  size_t i;
+
+  pages = palloc_get_multiple (PAL_ASSERT, CACHE_SIZE / per_page);
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[i];
+      e->valid = false;
+      e->accessed = false;
+      e->pin_cnt = 0;
+      e->evicting = false;
+      lock_init (&e->lock);
+      e->dirty = false;
+      e->data = pages + i * BLOCK_SECTOR_SIZE;
+    }
+  lock_init (&cache_lock);
+  /* === ADD p4q15 === */
+  lock_init (&flush_lock);
+  cond_init (&cache_unpinned);
+  cond_init (&evicted);
+  clock_hand = 0;
+
+  /* === ADD START p4q2 ===*/
+  lock_init (&read_ahead_lock);
+  cond_init (&read_ahead_ready);
+  read_ahead_head = read_ahead_queued = 0;
+  thread_create ("read-ahead", PRI_DEFAULT, read_ahead_daemon, NULL);
+  /* === ADD END p4q2 ===*/
+
+  /* === ADD START p4q3 ===*/
+  ASSERT (cache_dirty_high >= 1 && cache_dirty_high <= CACHE_SIZE);
+  dirty_cnt = 0;
+  flush_due = false;
+  cond_init (&flush_needed);
+  cond_init (&dirty_below_limit);
+  thread_create ("write-behind", PRI_DEFAULT, write_behind_daemon, NULL);
+  thread_create ("flush-timer", PRI_DEFAULT, flush_timer_daemon, NULL);
+  /* === ADD END p4q3 ===*/
+}
+
+/* Reads sector SECTOR into BUFFER, which must have room for
+   BLOCK_SECTOR_SIZE bytes. */
+void
+cache_read (block_sector_t sector, void *buffer)
+{
+  cache_read_at (sector, buffer, 0, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads SIZE bytes starting at byte offset OFS within sector
+   SECTOR into BUFFER. */
+void
+cache_read_at (block_sector_t sector, void *buffer, int ofs, int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, true);
+  memcpy (buffer, e->data + ofs, size);
+  cache_put (e, false);
+}
+
+/* Writes BLOCK_SECTOR_SIZE bytes from BUFFER to sector SECTOR. */
+void
+cache_write (block_sector_t sector, const void *buffer)
+{
+  cache_write_at (sector, buffer, 0, BLOCK_SECTOR_SIZE);
+}
+
+/* Writes SIZE bytes from BUFFER at byte offset OFS within
+   sector SECTOR.  The rest of the sector is preserved. */
+void
+cache_write_at (block_sector_t sector, const void *buffer, int ofs, int size)
+{
+  /* === MODIFY p4q12 === */
+  write_at (sector, buffer, ofs, size, false);
+}
+
+/* === ADD START p4q12 ===*/
+/* Writes BLOCK_SECTOR_SIZE bytes of metadata from BUFFER to
+   sector SECTOR, through the journal. */
+void
+cache_write_meta (block_sector_t sector, const void *buffer)
+{
+  write_at (sector, buffer, 0, BLOCK_SECTOR_SIZE, true);
+}
+
+/* Writes SIZE bytes of metadata from BUFFER at byte offset OFS
+   within sector SECTOR, through the journal.  The rest of the
+   sector is preserved. */
+void
+cache_write_meta_at (block_sector_t sector, const void *buffer, int ofs,
+                     int size)
+{
+  write_at (sector, buffer, ofs, size, true);
+}
+
+/* Writes SIZE bytes from BUFFER at byte offset OFS within sector
+   SECTOR, and hands the sector to the journal if it is METADATA
+   or the journal already holds it. */
+static void
+write_at (block_sector_t sector, const void *buffer, int ofs, int size,
+          bool metadata)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  /* === ADD START p4q3 ===*/
+  throttle_writer ();
+  /* === ADD END p4q3 ===*/
+
+  /* A write that covers the whole sector need not read it. */
+  e = cache_get (sector, size < BLOCK_SECTOR_SIZE);
+  memcpy (e->data + ofs, buffer, size);
+  if (journal_write (sector, e->data, metadata))
+    {
+      /* The journal writes the sector from now on. */
+      bool was_dirty = e->dirty;
+
+      e->dirty = false;
+      lock_release (&e->lock);
+      cache_unpin (e, was_dirty ? -1 : 0);
+    }
+  else
+    cache_put (e, true);
+}
+/* === ADD END p4q12 ===*/
+
+/* === ADD START p4q13 ===*/
+/* Fills the CNT sectors starting at SECTOR with zeros.  The
+   sectors are written to disk directly, in as few requests as
+   possible, without displacing other entries from the cache.
+   Any copy of them that the cache or the journal still holds,
+   for example from a file that used them before, is then zeroed
+   too, so that it is never written back over the zeros. */
+void
+cache_zero (block_sector_t sector, size_t cnt)
+{
+  static const uint8_t zeros[BLOCK_SECTOR_SIZE * 8];
+  size_t per_write = sizeof zeros / BLOCK_SECTOR_SIZE;
+  size_t i;
+
+  for (i = 0; i < cnt; i += per_write)
+    block_write_multi (fs_device, sector + i,
+                       cnt - i < per_write ? cnt - i : per_write, zeros);
+
+  /* A sector loaded after the check below was read after the
+     write above, so it holds zeros already. */
+  for (i = 0; i < cnt; i++)
+    {
+      bool cached;
+
+      lock_acquire (&cache_lock);
+      cached = lookup (sector + i) != NULL;
+      lock_release (&cache_lock);
+      if (cached)
+        cache_write (sector + i, zeros);
+      else
+        journal_write (sector + i, zeros, false);
+    }
+}
+/* === ADD END p4q13 ===*/
+
+/* === ADD START p4q2 ===*/
+/* Asks for SECTOR to be brought into the cache in the
+   background.  Returns without waiting for the disk. */
+void
+cache_read_ahead (block_sector_t sector)
+{
+  lock_acquire (&read_ahead_lock);
+  if (read_ahead_queued < READ_AHEAD_QUEUE)
+    {
+      size_t tail = (read_ahead_head + read_ahead_queued)
+                    % READ_AHEAD_QUEUE;
+      read_ahead_queue[tail] = sector;
+      read_ahead_queued++;
+      cond_signal (&read_ahead_ready, &read_ahead_lock);
+    }
+  lock_release (&read_ahead_lock);
+}
+/* === ADD END p4q2 ===*/
+
+/* Writes every dirty entry back to the file system device. */
+void
+cache_flush (void)
+{
+  /* === ADD START p4q15 ===*/
+  /* The writes are all submitted before waiting for any, so
+     that the device's request queue can put them in an efficient
+     order and merge writes to adjacent sectors. */
+  static struct block_request requests[CACHE_SIZE];
+  static void *buffers[CACHE_SIZE];
+  static struct cache_entry *writing[CACHE_SIZE];
+  size_t write_cnt = 0;
+  /* === ADD END p4q15 ===*/
+  size_t i;
+
+  /* === ADD p4q15 === */
+  lock_acquire (&flush_lock);
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[i];
+
+      lock_acquire (&cache_lock);
+      if (!e->valid)
+        {
+          lock_release (&cache_lock);
+          continue;
+        }
+      e->pin_cnt++;
+      lock_release (&cache_lock);
+
+      /* === MODIFY START p4q3 ===*/
+      lock_acquire (&e->lock);
+      if (e->dirty)
+        {
+          /* === MODIFY START p4q15 ===*/
+          buffers[write_cnt] = e->data;
+          block_request_init (&requests[write_cnt], true, e->sector, 1,
+                              &buffers[write_cnt]);
+          block_submit (fs_device, &requests[write_cnt]);
+          writing[write_cnt++] = e;
+          /* === MODIFY END p4q15 ===*/
+        }
+      else
+        cache_put (e, false);
+      /* === MODIFY END p4q3 ===*/
+    }
+
+  /* === ADD START p4q15 ===*/
+  for (i = 0; i < write_cnt; i++)
+    {
+      struct cache_entry *e = writing[i];
+
+      block_wait (&requests[i]);
+      e->dirty = false;
+      lock_release (&e->lock);
+      cache_unpin (e, -1);
+    }
+  lock_release (&flush_lock);
+  /* === ADD END p4q15 ===*/
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void)
+{
+  /* === MODIFY p4q2 === */
+  printf ("Cache: %llu hits, %llu misses, %llu read ahead\n",
+          hit_cnt, miss_cnt, read_ahead_cnt);
+  /* === ADD START p4q3 ===*/
+  printf ("Cache: %llu throttled writes\n", throttle_cnt);
+  /* === ADD END p4q3 ===*/
+}
+
+/* Returns the entry in the cache that holds SECTOR, or a null
+   pointer if there is none.  CACHE_LOCK must be held. */
+static struct cache_entry *
+lookup (block_sector_t sector)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].valid && cache[i].sector == sector)
+      return &cache[i];
+  return NULL;
+}
+
+/* Chooses an unpinned entry to replace, giving entries that
+   were used since the last sweep a second chance.  Waits if
+   every entry is pinned.  CACHE_LOCK must be held. */
+static struct cache_entry *
+choose_victim (void)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  for (;;)
+    {
+      size_t i;
+
+      /* Two sweeps clear every accessed bit, so if nothing turns
+         up by then, every entry is pinned. */
+      for (i = 0; i < 2 * CACHE_SIZE; i++)
+        {
+          struct cache_entry *e = &cache[clock_hand];
+          clock_hand = (clock_hand + 1) % CACHE_SIZE;
+
+          if (e->pin_cnt > 0)
+            continue;
+          if (!e->valid || !e->accessed)
+            return e;
+          e->accessed = false;
+        }
+      cond_wait (&cache_unpinned, &cache_lock);
+    }
+}
+
+/* Returns the entry for SECTOR, pinned and with its lock held.
+   On a miss, an entry is evicted to make room and, if FILL is
+   true, SECTOR's data is read into it; otherwise the caller must
+   overwrite the whole sector. */
+static struct cache_entry *
+cache_get (block_sector_t sector, bool fill)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  while ((e = lookup (sector)) != NULL && e->evicting)
+    cond_wait (&evicted, &cache_lock);
+  if (e != NULL)
+    {
+      hit_cnt++;
+      e->pin_cnt++;
+      e->accessed = true;
+      lock_release (&cache_lock);
+      lock_acquire (&e->lock);
+      return e;
+    }
+
+  miss_cnt++;
+  /* === MODIFY START p4q2 ===*/
+  return cache_load (sector, fill);
+}
+
+/* Evicts an entry and reuses it for SECTOR, which must not be in
+   the cache, as cache_get().  CACHE_LOCK must be held on entry
+   and is released on return. */
+static struct cache_entry *
+cache_load (block_sector_t sector, bool fill)
+{
+  struct cache_entry *e;
+
+  ASSERT (lookup (sector) == NULL);
+  e = choose_victim ();
+  /* === MODIFY END p4q2 ===*/
+  e->pin_cnt++;
+
+  /* Write back the old contents before anyone can look up the
+     old sector again, so that they never read stale data from
+     the disk.  An unpinned entry is never locked, so E's DIRTY
+     may be read before taking its lock. */
+  if (e->valid && e->dirty)
+    {
+      struct cache_entry *other;
+
+      e->evicting = true;
+      lock_release (&cache_lock);
+      lock_acquire (&e->lock);
+      block_write (fs_device, e->sector, e->data);
+      e->dirty = false;
+
+      lock_acquire (&cache_lock);
+      e->evicting = false;
+      cond_broadcast (&evicted, &cache_lock);
+      /* === ADD START p4q3 ===*/
+      dirty_cnt--;
+      cond_broadcast (&dirty_below_limit, &cache_lock);
+      /* === ADD END p4q3 ===*/
+
+      /* Another thread may have loaded SECTOR meanwhile.  Then
+         use its entry, and leave E holding the old sector, which
+         is now clean. */
+      while ((other = lookup (sector)) != NULL && other->evicting)
+        cond_wait (&evicted, &cache_lock);
+      if (other != NULL)
+        {
+          lock_release (&e->lock);
+          if (--e->pin_cnt == 0)
+            cond_broadcast (&cache_unpinned, &cache_lock);
+          other->pin_cnt++;
+          other->accessed = true;
+          lock_release (&cache_lock);
+          lock_acquire (&other->lock);
+          return other;
+        }
+    }
+  else
+    lock_acquire (&e->lock);
+  e->sector = sector;
+  e->valid = true;
+  e->accessed = true;
+  lock_release (&cache_lock);
+
+  /* Threads that look up SECTOR from now on find E and wait on
+     its lock until the data is in. */
+  if (fill)
+    /* === MODIFY p4q12 === */
+    journal_read (sector, e->data);
+  return e;
+}
+
+/* === ADD START p4q2 ===*/
+/* Read-ahead thread.  Loads the sectors queued by
+   cache_read_ahead() that are not already cached, while the
+   threads that asked for them go on with their work. */
+static void
+read_ahead_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      block_sector_t sector;
+
+      lock_acquire (&read_ahead_lock);
+      while (read_ahead_queued == 0)
+        cond_wait (&read_ahead_ready, &read_ahead_lock);
+      sector = read_ahead_queue[read_ahead_head];
+      read_ahead_head = (read_ahead_head + 1) % READ_AHEAD_QUEUE;
+      read_ahead_queued--;
+      lock_release (&read_ahead_lock);
+
+      lock_acquire (&cache_lock);
+      if (lookup (sector) != NULL)
+        lock_release (&cache_lock);
+      else
+        {
+          read_ahead_cnt++;
+          cache_put (cache_load (sector, true), false);
+        }
+    }
+}
+/* === ADD END p4q2 ===*/
+
+/* Releases E, obtained from cache_get().  If DIRTY is true, the
+   entry was modified and must eventually be written back. */
+static void
+cache_put (struct cache_entry *e, bool dirty)
+{
+  /* === MODIFY START p4q3 ===*/
+  bool newly_dirty = dirty && !e->dirty;
+
+  if (dirty)
+    e->dirty = true;
+  lock_release (&e->lock);
+  cache_unpin (e, newly_dirty ? 1 : 0);
+  /* === MODIFY END p4q3 ===*/
+}
+
+/* === ADD START p4q3 ===*/
+/* Drops a pin on E, whose lock the caller has released, and
+   adjusts the dirty entry count by DIRTY_CHANGE. */
+static void
+cache_unpin (struct cache_entry *e, int dirty_change)
+{
+  lock_acquire (&cache_lock);
+  dirty_cnt += dirty_change;
+  if (dirty_change > 0 && dirty_cnt >= cache_dirty_high)
+    cond_signal (&flush_needed, &cache_lock);
+  else if (dirty_change < 0 && dirty_cnt < dirty_limit ())
+    cond_broadcast (&dirty_below_limit, &cache_lock);
+
+  ASSERT (e->pin_cnt > 0);
+  if (--e->pin_cnt == 0)
+    cond_broadcast (&cache_unpinned, &cache_lock);
+  lock_release (&cache_lock);
+}
+
+/* Returns the number of dirty entries at which writers start to
+   wait for the write-behind thread. */
+static size_t
+dirty_limit (void)
+{
+  return cache_dirty_high + (CACHE_SIZE - cache_dirty_high) / 2;
+}
+
+/* Waits while too much of the cache is dirty. */
+static void
+throttle_writer (void)
+{
+  lock_acquire (&cache_lock);
+  if (dirty_cnt >= dirty_limit ())
+    {
+      throttle_cnt++;
+      do
+        {
+          cond_signal (&flush_needed, &cache_lock);
+          cond_wait (&dirty_below_limit, &cache_lock);
+        }
+      while (dirty_cnt >= dirty_limit ());
+    }
+  lock_release (&cache_lock);
+}
+
+/* Write-behind thread.  Writes back dirty entries when the
+   periodic timer asks for it or when too many are dirty. */
+static void
+write_behind_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      lock_acquire (&cache_lock);
+      while (!flush_due && dirty_cnt < cache_dirty_high)
+        cond_wait (&flush_needed, &cache_lock);
+      flush_due = false;
+      lock_release (&cache_lock);
+
+      cache_flush ();
+    }
+}
+
+/* Requests a write-behind pass every WRITE_BEHIND_INTERVAL
+   ticks. */
+static void
+flush_timer_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (WRITE_BEHIND_INTERVAL);
+      lock_acquire (&cache_lock);
+      if (dirty_cnt > 0)
+        {
+          flush_due = true;
+          cond_signal (&flush_needed, &cache_lock);
+        }
+      lock_release (&cache_lock);
+    }
+}
+/* === ADD END p4q3 ===*/
+/* === ADD END p4q1 ===*/
@@ -0,0 +1,34 @@
+/* === ADD START p4q1 ===*/
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Number of sectors held by the buffer cache. */
+#define CACHE_SIZE 64
+
+/* === ADD START p4q3 ===*/
+extern size_t cache_dirty_high;
+/* === ADD END p4q3 ===*/
+
+void cache_init (void);
+void cache_read (block_sector_t, void *);
+void cache_read_at (block_sector_t, void *, int ofs, int size);
+void cache_write (block_sector_t, const void *);
+void cache_write_at (block_sector_t, const void *, int ofs, int size);
+/* === ADD START p4q12 ===*/
+void cache_write_meta (block_sector_t, const void *);
+void cache_write_meta_at (block_sector_t, const void *, int ofs, int size);
+/* === ADD END p4q12 ===*/
+/* === ADD p4q13 === */
+void cache_zero (block_sector_t, size_t cnt);
+/* === ADD START p4q2 ===*/
+void cache_read_ahead (block_sector_t);
+/* === ADD END p4q2 ===*/
+void cache_flush (void);
+void cache_print_stats (void);
+
+#endif /* filesys/cache.h */
+/* === ADD END p4q1 ===*/
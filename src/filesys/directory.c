@@ -2,9 +2,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+/* === ADD START p4q7 ===*/
+#include <hash.h>
+#include <round.h>
+/* === ADD END p4q7 ===*/
+/* === ADD p4q8 === */
+#include "filesys/name-cache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+/* === ADD p4q12 === */
+#include "filesys/journal.h"
 
 /* A directory. */
 struct dir 
@@ -21,12 +29,39 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* === ADD START p4q7 ===*/
+/* A directory is a hash table of buckets, one per sector.  A
+   name hashes to a home bucket, and is stored there or, if that
+   bucket is full, in the first following bucket (wrapping
+   around) that has a free entry.  Each bucket has an overflow
+   flag, set once an entry whose probe passed through it had to
+   be stored further on, so a lookup stops at the first bucket
+   without the flag.  When an entry would land more than
+   DIR_PROBE_MAX buckets from home, the directory is doubled and
+   rehashed, which keeps a lookup to a few sector reads. */
+
+/* Entries per bucket, and byte offset of a bucket's overflow
+   flag, which sits in the space left after its entries. */
+#define ENTRIES_PER_BUCKET (BLOCK_SECTOR_SIZE / sizeof (struct dir_entry))
+#define OVERFLOW_OFS (ENTRIES_PER_BUCKET * sizeof (struct dir_entry))
+
+/* Largest number of buckets an entry may be placed past its home
+   bucket before the directory is grown. */
+#define DIR_PROBE_MAX 2
+
+/* === ADD END p4q7 ===*/
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (block_sector_t sector, size_t entry_cnt)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  /* === MODIFY START p4q7 ===*/
+  size_t bucket_cnt = DIV_ROUND_UP (entry_cnt, ENTRIES_PER_BUCKET);
+  if (bucket_cnt == 0)
+    bucket_cnt = 1;
+  return inode_create (sector, bucket_cnt * BLOCK_SECTOR_SIZE);
+  /* === MODIFY END p4q7 ===*/
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -39,6 +74,8 @@ dir_open (struct inode *inode)
     {
       dir->inode = inode;
       dir->pos = 0;
+      /* === ADD p4q12 === */
+      inode_set_metadata (inode);
       return dir;
     }
   else
@@ -83,6 +120,53 @@ dir_get_inode (struct dir *dir)
   return dir->inode;
 }
 
+/* === ADD START p4q7 ===*/
+/* Returns the number of buckets in DIR. */
+static size_t
+bucket_cnt (const struct dir *dir)
+{
+  return inode_length (dir->inode) / BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the byte offset of entry SLOT in BUCKET. */
+static off_t
+entry_ofs (size_t bucket, size_t slot)
+{
+  return bucket * BLOCK_SECTOR_SIZE + slot * sizeof (struct dir_entry);
+}
+
+/* Returns the byte offset of the entry that follows the one at
+   OFS, skipping the end of a bucket after its last entry. */
+static off_t
+next_entry (off_t ofs)
+{
+  ofs += sizeof (struct dir_entry);
+  if (ofs % BLOCK_SECTOR_SIZE == (off_t) OVERFLOW_OFS)
+    ofs = ROUND_UP (ofs, BLOCK_SECTOR_SIZE);
+  return ofs;
+}
+
+/* Returns the home bucket of NAME in a directory of BUCKET_CNT
+   buckets. */
+static size_t
+home_bucket (const char *name, size_t bucket_cnt)
+{
+  return hash_string (name) % bucket_cnt;
+}
+
+/* Returns true if BUCKET in DIR has its overflow flag set. */
+static bool
+overflowed (const struct dir *dir, size_t bucket)
+{
+  bool flag;
+
+  return (inode_read_at (dir->inode, &flag, sizeof flag,
+                         bucket * BLOCK_SECTOR_SIZE + OVERFLOW_OFS)
+          == sizeof flag
+          && flag);
+}
+/* === ADD END p4q7 ===*/
+
 /* Searches DIR for a file with the given NAME.
    If successful, returns true, sets *EP to the directory entry
    if EP is non-null, and sets *OFSP to the byte offset of the
@@ -93,24 +177,167 @@ lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
   struct dir_entry e;
-  size_t ofs;
+  /* === MODIFY START p4q7 ===*/
+  size_t cnt = bucket_cnt (dir);
+  size_t bucket, i, slot;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
-      {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
-      }
+  if (cnt == 0)
+    return false;
+
+  /* Probe from NAME's home bucket until a bucket that nothing
+     has overflowed from. */
+  bucket = home_bucket (name, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      for (slot = 0; slot < ENTRIES_PER_BUCKET; slot++)
+        {
+          off_t ofs = entry_ofs (bucket, slot);
+
+          if (inode_read_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+            return false;
+          if (e.in_use && !strcmp (name, e.name)) 
+            {
+              if (ep != NULL)
+                *ep = e;
+              if (ofsp != NULL)
+                *ofsp = ofs;
+              return true;
+            }
+        }
+      if (!overflowed (dir, bucket))
+        break;
+      bucket = (bucket + 1) % cnt;
+    }
+  /* === MODIFY END p4q7 ===*/
   return false;
 }
 
+/* === ADD START p4q7 ===*/
+/* Returns the byte offset of the free entry in DIR where NAME
+   would be stored, or -1 if DIR is full, and sets *DISTANCE to
+   the number of buckets that entry is past NAME's home bucket. */
+static off_t
+find_slot (const struct dir *dir, const char *name, size_t *distance)
+{
+  struct dir_entry e;
+  size_t cnt = bucket_cnt (dir);
+  size_t bucket, i, slot;
+
+  if (cnt == 0)
+    return -1;
+  bucket = home_bucket (name, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      for (slot = 0; slot < ENTRIES_PER_BUCKET; slot++)
+        {
+          off_t ofs = entry_ofs (bucket, slot);
+
+          if (inode_read_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+            return -1;
+          if (!e.in_use)
+            {
+              *distance = i;
+              return ofs;
+            }
+        }
+      bucket = (bucket + 1) % cnt;
+    }
+  return -1;
+}
+
+/* Stores E in the first free entry of DIR along its name's probe
+   sequence, setting the overflow flag of each full bucket passed
+   on the way.
+   Returns true if successful, false if DIR is full or a write
+   fails. */
+static bool
+place (struct dir *dir, const struct dir_entry *e)
+{
+  size_t cnt = bucket_cnt (dir);
+  size_t distance, i;
+  off_t ofs = find_slot (dir, e->name, &distance);
+  const bool flag = true;
+
+  if (ofs < 0)
+    return false;
+  for (i = 0; i < distance; i++)
+    {
+      size_t bucket = (home_bucket (e->name, cnt) + i) % cnt;
+      off_t flag_ofs = bucket * BLOCK_SECTOR_SIZE + OVERFLOW_OFS;
+
+      if (inode_write_at (dir->inode, &flag, sizeof flag, flag_ofs)
+          != sizeof flag)
+        return false;
+    }
+  return inode_write_at (dir->inode, e, sizeof *e, ofs) == sizeof *e;
+}
+
+/* Doubles the number of buckets in DIR and rehashes its
+   entries into them.
+   Returns true if successful.  Returns false if DIR could not be
+   grown at all, leaving it unchanged.  If the disk fills up
+   part way, DIR is rehashed into the buckets it did get. */
+static bool
+grow (struct dir *dir)
+{
+  static const char zeros[BLOCK_SECTOR_SIZE];
+  size_t old_cnt = bucket_cnt (dir);
+  size_t new_cnt, entry_cnt, i;
+  struct dir_entry *entries;
+  off_t ofs;
+
+  /* === ADD START p4q12 ===*/
+  /* Every bucket is rewritten, which must fit in the journal. */
+  if (!journal_extend (2 * old_cnt + 1
+                       + inode_index_sectors (old_cnt * BLOCK_SECTOR_SIZE)))
+    return false;
+  /* === ADD END p4q12 ===*/
+
+  /* Save the entries in use. */
+  entries = malloc (old_cnt * ENTRIES_PER_BUCKET * sizeof *entries);
+  if (entries == NULL)
+    return false;
+  entry_cnt = 0;
+  for (ofs = 0; ofs < (off_t) (old_cnt * BLOCK_SECTOR_SIZE);
+       ofs = next_entry (ofs))
+    {
+      struct dir_entry *e = &entries[entry_cnt];
+
+      if (inode_read_at (dir->inode, e, sizeof *e, ofs) != sizeof *e)
+        {
+          free (entries);
+          return false;
+        }
+      if (e->in_use)
+        entry_cnt++;
+    }
+
+  /* Add the new buckets. */
+  for (new_cnt = old_cnt; new_cnt < old_cnt * 2; new_cnt++)
+    if (inode_write_at (dir->inode, zeros, BLOCK_SECTOR_SIZE,
+                        new_cnt * BLOCK_SECTOR_SIZE) != BLOCK_SECTOR_SIZE)
+      break;
+  if (new_cnt == old_cnt)
+    {
+      free (entries);
+      return false;
+    }
+
+  /* Empty the old buckets and put the entries back.  There is
+     now more room than before, so every entry fits. */
+  for (i = 0; i < old_cnt; i++)
+    inode_write_at (dir->inode, zeros, BLOCK_SECTOR_SIZE,
+                    i * BLOCK_SECTOR_SIZE);
+  for (i = 0; i < entry_cnt; i++)
+    place (dir, &entries[i]);
+  free (entries);
+  return true;
+}
+/* === ADD END p4q7 ===*/
+
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
@@ -120,14 +347,34 @@ dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
   struct dir_entry e;
+  /* === ADD START p4q8 ===*/
+  block_sector_t dir_sector, sector;
+  /* === ADD END p4q8 ===*/
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+  /* === MODIFY START p4q8 ===*/
+  /* Search the directory only if the name cache does not know
+     the answer, and remember what the search found.  The inode
+     is opened before the directory is unlocked, so that it
+     cannot be removed in between. */
+  /* === ADD p4q11 === */
+  inode_lock_dir (dir->inode);
+  dir_sector = inode_get_inumber (dir->inode);
+  if (!name_cache_lookup (dir_sector, name, &sector))
+    {
+      sector = lookup (dir, name, &e, NULL) ? e.inode_sector : 0;
+      name_cache_insert (dir_sector, name, sector);
+    }
+
+  if (sector != 0)
+    *inode = inode_open (sector);
   else
     *inode = NULL;
+  /* === MODIFY END p4q8 ===*/
+  /* === ADD p4q11 === */
+  inode_unlock_dir (dir->inode);
 
   return *inode != NULL;
 }
@@ -142,7 +389,6 @@ bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
   struct dir_entry e;
-  off_t ofs;
   bool success = false;
 
   ASSERT (dir != NULL);
@@ -152,29 +398,38 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  /* === ADD p4q11 === */
+  inode_lock_dir (dir->inode);
+
   /* Check that NAME is not in use. */
   if (lookup (dir, name, NULL, NULL))
     goto done;
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  /* === MODIFY START p4q7 ===*/
+  /* Grow the directory if NAME would be stored too far from its
+     home bucket.  If growing fails, any free entry will do. */
+  {
+    size_t distance;
+
+    if (find_slot (dir, name, &distance) < 0 || distance > DIR_PROBE_MAX)
+      grow (dir);
+  }
 
   /* Write slot. */
+  memset (&e, 0, sizeof e);
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
-  success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  success = place (dir, &e);
+  /* === MODIFY END p4q7 ===*/
+  /* === ADD START p4q8 ===*/
+  if (success)
+    name_cache_insert (inode_get_inumber (dir->inode), name, inode_sector);
+  /* === ADD END p4q8 ===*/
 
  done:
+  /* === ADD p4q11 === */
+  inode_unlock_dir (dir->inode);
   return success;
 }
 
@@ -192,6 +447,9 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  /* === ADD p4q11 === */
+  inode_lock_dir (dir->inode);
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -210,8 +468,17 @@ dir_remove (struct dir *dir, const char *name)
   inode_remove (inode);
   success = true;
 
+  /* === ADD START p4q8 ===*/
+  /* NAME is gone, and so is anything cached under it in case it
+     was a directory. */
+  name_cache_insert (inode_get_inumber (dir->inode), name, 0);
+  name_cache_purge_dir (e.inode_sector);
+  /* === ADD END p4q8 ===*/
+
  done:
   inode_close (inode);
+  /* === ADD p4q11 === */
+  inode_unlock_dir (dir->inode);
   return success;
 }
 
@@ -222,15 +489,26 @@ bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  /* === ADD p4q11 === */
+  bool found = false;
 
+  /* === ADD p4q11 === */
+  inode_lock_dir (dir->inode);
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
-      dir->pos += sizeof e;
+      /* === MODIFY p4q7 === */
+      dir->pos = next_entry (dir->pos);
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
+          /* === MODIFY START p4q11 ===*/
+          found = true;
+          break;
+          /* === MODIFY END p4q11 ===*/
         } 
     }
-  return false;
+  /* === MODIFY START p4q11 ===*/
+  inode_unlock_dir (dir->inode);
+  return found;
+  /* === MODIFY END p4q11 ===*/
 }
@@ -2,6 +2,29 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+/* === ADD START p4q12 ===*/
+#include "filesys/free-map.h"
+#include "filesys/journal.h"
+/* === ADD END p4q12 ===*/
+/* === ADD p4q20 === */
+#include <iovec.h>
+/* === ADD START p4q2 ===*/
+#include "devices/block.h"
+
+/* Read-ahead window limits, in bytes.  The window opens at
+   READ_AHEAD_MIN on the second sequential read, doubles on each
+   further one up to READ_AHEAD_MAX, and closes on a seek. */
+#define READ_AHEAD_MIN (4 * BLOCK_SECTOR_SIZE)
+#define READ_AHEAD_MAX (32 * BLOCK_SECTOR_SIZE)
+/* === ADD END p4q2 ===*/
+
+/* === ADD START p4q12 ===*/
+/* Most bytes that one journal operation writes.  Growing a file
+   by this much changes at most two index sectors at each level,
+   plus the inode, which fits in what journal_begin() sets
+   aside. */
+#define WRITE_CHUNK (64 * BLOCK_SECTOR_SIZE)
+/* === ADD END p4q12 ===*/
 
 /* An open file. */
 struct file 
@@ -9,8 +32,20 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    /* === ADD START p4q2 ===*/
+    off_t ra_next;              /* Where a sequential read would start. */
+    off_t ra_end;               /* End of data already read ahead. */
+    off_t ra_window;            /* Bytes to keep read ahead of POS. */
+    /* === ADD END p4q2 ===*/
   };
 
+/* === ADD START p4q2 ===*/
+static void read_ahead (struct file *, off_t ofs, off_t size);
+/* === ADD END p4q2 ===*/
+/* === ADD p4q12 === */
+static off_t write_chunks (struct inode *, const struct iovec *, int iov_cnt,
+                           off_t offset);
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
@@ -23,6 +58,10 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      /* === ADD START p4q2 ===*/
+      file->ra_next = file->ra_end = 0;
+      file->ra_window = 0;
+      /* === ADD END p4q2 ===*/
       return file;
     }
   else
@@ -48,7 +87,12 @@ file_close (struct file *file)
   if (file != NULL)
     {
       file_allow_write (file);
+      /* === MODIFY START p4q12 ===*/
+      /* The last close may free the file's sectors. */
+      journal_begin ();
       inode_close (file->inode);
+      journal_end ();
+      /* === MODIFY END p4q12 ===*/
       free (file); 
     }
 }
@@ -68,7 +112,12 @@ file_get_inode (struct file *file)
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  /* === MODIFY START p4q2 ===*/
+  off_t bytes_read;
+
+  read_ahead (file, file->pos, size);
+  bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  /* === MODIFY END p4q2 ===*/
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -87,14 +136,20 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at the file's current position.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk fills up.
+   Writing past end of file extends the file.
    Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  /* === MODIFY START p4q12 ===*/
+  struct iovec iov;
+  off_t bytes_written;
+
+  iov.iov_base = (void *) buffer;
+  iov.iov_len = size;
+  bytes_written = write_chunks (file->inode, &iov, 1, file->pos);
+  /* === MODIFY END p4q12 ===*/
   file->pos += bytes_written;
   return bytes_written;
 }
@@ -102,16 +157,113 @@ file_write (struct file *file, const void *buffer, off_t size)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk fills up.
+   Writing past end of file extends the file.
    The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs) 
 {
-  return inode_write_at (file->inode, buffer, size, file_ofs);
+  /* === MODIFY START p4q12 ===*/
+  struct iovec iov;
+
+  iov.iov_base = (void *) buffer;
+  iov.iov_len = size;
+  return write_chunks (file->inode, &iov, 1, file_ofs);
+  /* === MODIFY END p4q12 ===*/
+}
+
+/* === ADD START p4q20 ===*/
+/* Reads from FILE, starting at the file's current position, into
+   the IOV_CNT segments of IOV, filling each before going on to
+   the next.  Returns the number of bytes actually read, which may
+   be less than the segments' total if end of file is reached.
+   Advances FILE's position by the number of bytes read. */
+off_t
+file_readv (struct file *file, const struct iovec *iov, int iov_cnt)
+{
+  off_t bytes_read, size = 0;
+  int i;
+
+  for (i = 0; i < iov_cnt; i++)
+    size += iov[i].iov_len;
+  read_ahead (file, file->pos, size);
+  bytes_read = inode_readv_at (file->inode, iov, iov_cnt, file->pos);
+  file->pos += bytes_read;
+  return bytes_read;
+}
+
+/* Writes the IOV_CNT segments of IOV, one after another, into
+   FILE, starting at the file's current position, in a single
+   pass through the inode.  Returns the number of bytes actually
+   written, which may be less than the segments' total if the
+   disk fills up.  Advances FILE's position by the number of bytes
+   written. */
+off_t
+file_writev (struct file *file, const struct iovec *iov, int iov_cnt)
+{
+  off_t bytes_written;
+
+  /* === MODIFY p4q12 === */
+  bytes_written = write_chunks (file->inode, iov, iov_cnt, file->pos);
+  file->pos += bytes_written;
+  return bytes_written;
 }
+/* === ADD END p4q20 ===*/
+
+/* === ADD START p4q18 ===*/
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, to DST, starting at its current position, a sector
+   at a time through a kernel buffer.  Returns the number of
+   bytes copied, which may be less than SIZE if end of SRC is
+   reached or the disk fills up, or -1 if SRC and DST are the
+   same file and the two ranges overlap.  Advances both files'
+   positions by the number of bytes copied.
+
+   The pieces are cut so that, after the first, each one covers a
+   whole sector of DST, which the buffer cache can then overwrite
+   without reading it first. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size)
+{
+  uint8_t buffer[BLOCK_SECTOR_SIZE];
+  off_t bytes_copied = 0;
+
+  /* Each piece would be read back after it was written, and with
+     a single open file both positions would advance twice. */
+  if (src->inode == dst->inode
+      && (src == dst
+          || (src->pos > dst->pos
+              ? src->pos - dst->pos : dst->pos - src->pos) < size))
+    return -1;
+
+  while (size > 0)
+    {
+      off_t chunk_size = BLOCK_SECTOR_SIZE - dst->pos % BLOCK_SECTOR_SIZE;
+      off_t bytes_read, bytes_written;
+
+      if (chunk_size > size)
+        chunk_size = size;
+      read_ahead (src, src->pos, chunk_size);
+      bytes_read = inode_read_at (src->inode, buffer, chunk_size, src->pos);
+      if (bytes_read == 0)
+        break;
+
+      journal_begin ();
+      bytes_written = inode_write_at (dst->inode, buffer, bytes_read,
+                                      dst->pos);
+      journal_end ();
+
+      src->pos += bytes_written;
+      dst->pos += bytes_written;
+      bytes_copied += bytes_written;
+      size -= bytes_written;
+      if (bytes_written != bytes_read)
+        break;
+    }
+  return bytes_copied;
+}
+/* === ADD END p4q18 ===*/
 
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
@@ -166,3 +318,103 @@ file_tell (struct file *file)
   ASSERT (file != NULL);
   return file->pos;
 }
+
+/* === ADD START p4q2 ===*/
+/* Called before FILE reads SIZE bytes at OFS.  If the read
+   continues where the previous one stopped, widens FILE's
+   read-ahead window and asks the inode layer to prefetch the
+   part of the window past this read that has not been requested
+   yet.  Otherwise the access is random and the window closes. */
+static void
+read_ahead (struct file *file, off_t ofs, off_t size)
+{
+  off_t start, end;
+
+  if (ofs != file->ra_next)
+    {
+      file->ra_window = 0;
+      file->ra_end = ofs + size;
+    }
+  else if (file->ra_window == 0)
+    file->ra_window = READ_AHEAD_MIN;
+  else if (file->ra_window < READ_AHEAD_MAX)
+    file->ra_window *= 2;
+  file->ra_next = ofs + size;
+
+  if (file->ra_window == 0)
+    return;
+  start = file->ra_end > ofs + size ? file->ra_end : ofs + size;
+  end = ofs + size + file->ra_window;
+  if (start < end)
+    {
+      inode_read_ahead (file->inode, start, end - start);
+      file->ra_end = end;
+    }
+}
+/* === ADD END p4q2 ===*/
+
+/* === ADD START p4q12 ===*/
+/* Writes the IOV_CNT segments of IOV, one after another, into
+   INODE, starting at OFFSET, as a series of journal operations
+   that each write at most WRITE_CHUNK bytes, so that none of
+   them changes more metadata than it set aside.  Returns the
+   number of bytes actually written, which may be less than the
+   segments' total if the disk fills up. */
+static off_t
+write_chunks (struct inode *inode, const struct iovec *iov, int iov_cnt,
+              off_t offset)
+{
+  off_t bytes_written = 0;
+  size_t skip = 0;              /* Bytes of IOV[0] already written. */
+  bool retried = false;
+
+  ASSERT (iov_cnt <= IOV_MAX);
+  while (iov_cnt > 0)
+    {
+      struct iovec chunk[IOV_MAX];
+      size_t chunk_size = 0;
+      int chunk_cnt = 0;
+      off_t n;
+
+      /* Take segments, or parts of them, up to WRITE_CHUNK bytes. */
+      while (chunk_cnt < iov_cnt && chunk_size < WRITE_CHUNK)
+        {
+          size_t ofs = chunk_cnt == 0 ? skip : 0;
+          size_t len = iov[chunk_cnt].iov_len - ofs;
+
+          if (len > WRITE_CHUNK - chunk_size)
+            len = WRITE_CHUNK - chunk_size;
+          chunk[chunk_cnt].iov_base
+            = (uint8_t *) iov[chunk_cnt].iov_base + ofs;
+          chunk[chunk_cnt].iov_len = len;
+          chunk_size += len;
+          chunk_cnt++;
+        }
+
+      journal_begin ();
+      n = inode_writev_at (inode, chunk, chunk_cnt, offset + bytes_written);
+      journal_end ();
+      bytes_written += n;
+      if ((size_t) n < chunk_size)
+        {
+          /* The disk may only have seemed full because sectors
+             released since the last commit were not free yet.
+             Commit, and try the rest once more. */
+          if (retried || !free_map_has_released ())
+            break;
+          retried = true;
+          journal_commit ();
+        }
+
+      /* Move past what was written. */
+      skip += n;
+      while (iov_cnt > 0 && skip >= iov[0].iov_len)
+        {
+          skip -= iov[0].iov_len;
+          iov++;
+          iov_cnt--;
+        }
+    }
+  return bytes_written;
+}
+/* === ADD END p4q12 ===*/
@@ -16,6 +16,13 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+/* === ADD START p4q20 ===*/
+struct iovec;
+off_t file_readv (struct file *, const struct iovec *, int iov_cnt);
+off_t file_writev (struct file *, const struct iovec *, int iov_cnt);
+/* === ADD END p4q20 ===*/
+/* === ADD p4q18 === */
+off_t file_copy (struct file *dst, struct file *src, off_t size);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
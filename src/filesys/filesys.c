@@ -6,11 +6,20 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+/* === ADD START p4q1 ===*/
+#include "filesys/cache.h"
+/* === ADD END p4q1 ===*/
+/* === ADD p4q8 === */
+#include "filesys/name-cache.h"
+/* === ADD p4q12 === */
+#include "filesys/journal.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
 static void do_format (void);
+/* === ADD p4q12 === */
+static bool create (const char *name, off_t initial_size);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -21,11 +30,22 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  /* === ADD START p4q1 ===*/
+  cache_init ();
+  /* === ADD END p4q1 ===*/
+  /* === ADD p4q8 === */
+  name_cache_init ();
   inode_init ();
   free_map_init ();
+  /* === ADD p4q12 === */
+  journal_init (format);
 
   if (format) 
     do_format ();
+  /* === ADD START p4q5 ===*/
+  else
+    inode_use_format_of (ROOT_DIR_SECTOR);
+  /* === ADD END p4q5 ===*/
 
   free_map_open ();
 }
@@ -36,27 +56,80 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  /* === MODIFY p4q3 === */
+  filesys_sync ();
+  /* === ADD p4q12 === */
+  journal_done ();
 }
 
+/* === ADD START p4q3 ===*/
+/* Writes all file system data that is only in memory to disk.
+   Metadata may only reach the journal's log, from which it is
+   recovered if need be. */
+void
+filesys_sync (void)
+{
+  /* === MODIFY p4q12 === */
+  journal_commit ();
+}
+/* === ADD END p4q3 ===*/
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
    or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) 
+{
+  /* === MODIFY START p4q12 ===*/
+  bool released = free_map_has_released ();
+  bool success = create (name, initial_size);
+
+  /* The disk may only have seemed full because sectors released
+     since the last commit were not free yet.  Commit, and try
+     once more. */
+  if (!success && released)
+    {
+      journal_commit ();
+      success = create (name, initial_size);
+    }
+  return success;
+  /* === MODIFY END p4q12 ===*/
+}
+
+/* === ADD START p4q12 ===*/
+/* Creates a file named NAME with the given INITIAL_SIZE, as one
+   journal operation.  Returns true if successful, false
+   otherwise. */
+static bool
+create (const char *name, off_t initial_size)
 {
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  struct dir *dir;
+  block_sector_t goal;
+  bool success;
+
+  /* The new inode's index sectors count against the journal. */
+  if (!journal_begin_sectors (JOURNAL_OP_SECTORS
+                              + inode_index_sectors (initial_size)))
+    return false;
+  dir = dir_open_root ();
+  /* === MODIFY START p4q10 ===*/
+  /* Place the new inode near its directory. */
+  goal = dir != NULL ? inode_get_inumber (dir_get_inode (dir)) : 0;
+  success = (dir != NULL
+             && free_map_allocate_near (1, goal, &inode_sector)
+  /* === MODIFY END p4q10 ===*/
+             && inode_create (inode_sector, initial_size)
+             && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  journal_end ();
 
   return success;
 }
+/* === ADD END p4q12 ===*/
 
 /* Opens the file with the given NAME.
    Returns the new file if successful or a null pointer
@@ -66,12 +139,17 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
+  /* === MODIFY START p4q12 ===*/
+  struct dir *dir;
   struct inode *inode = NULL;
 
+  journal_begin ();
+  dir = dir_open_root ();
   if (dir != NULL)
     dir_lookup (dir, name, &inode);
   dir_close (dir);
+  journal_end ();
+  /* === MODIFY END p4q12 ===*/
 
   return file_open (inode);
 }
@@ -83,9 +161,16 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  /* === MODIFY START p4q12 ===*/
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name);
   dir_close (dir); 
+  journal_end ();
+  /* === MODIFY END p4q12 ===*/
 
   return success;
 }
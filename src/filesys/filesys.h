@@ -7,12 +7,17 @@
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+/* === ADD p4q12 === */
+#define JOURNAL_SECTOR 2        /* Journal header sector. */
 
 /* Block device that contains the file system. */
 extern struct block *fs_device;
 
 void filesys_init (bool format);
 void filesys_done (void);
+/* === ADD START p4q3 ===*/
+void filesys_sync (void);
+/* === ADD END p4q3 ===*/
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
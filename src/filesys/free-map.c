@@ -1,12 +1,235 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+/* === ADD START p4q9 ===*/
+#include <limits.h>
+#include <round.h>
+/* === ADD END p4q9 ===*/
+/* === ADD p4q10 === */
+#include <string.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+/* === ADD p4q10 === */
+#include "threads/malloc.h"
+/* === ADD p4q11 === */
+#include "threads/synch.h"
+/* === ADD p4q12 === */
+#include "filesys/journal.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+/* === ADD START p4q11 ===*/
+/* Protects the free map, the dirty map and the group summaries.
+   It is never held across disk I/O. */
+static struct lock free_map_lock;
+/* === ADD END p4q11 ===*/
+/* === ADD START p4q9 ===*/
+/* Changes to the free map are only written to the free map file
+   by free_map_flush(), and only for the sectors of the file that
+   changed.  DIRTY_MAP has one bit per sector of the file. */
+#define BITS_PER_SECTOR (BLOCK_SECTOR_SIZE * CHAR_BIT)
+static struct bitmap *dirty_map;     /* Free map file sectors to write. */
+/* === ADD START p4q12 ===*/
+/* While the journal is in use, released sectors stay allocated
+   until the next flush, which a commit runs before writing the
+   free map to the log.  Otherwise a sector could be given to a
+   new file, and overwritten, before the operation that freed it
+   was committed.  An allocation that fails for want of them is
+   retried by its caller after a commit; see
+   free_map_has_released(). */
+static struct bitmap *released;      /* Sectors to free at flush. */
+static size_t released_cnt;          /* Number of sectors in RELEASED. */
+/* === ADD END p4q12 ===*/
+
+/* Marks the sectors of the free map file that hold the bits for
+   the CNT sectors starting at SECTOR as needing to be written. */
+static void
+mark_dirty (block_sector_t sector, size_t cnt)
+{
+  size_t first = sector / BITS_PER_SECTOR;
+  size_t last = (sector + cnt - 1) / BITS_PER_SECTOR;
+
+  if (cnt > 0)
+    bitmap_set_multiple (dirty_map, first, last - first + 1, true);
+}
+/* === ADD END p4q9 ===*/
+
+/* === ADD START p4q10 ===*/
+/* Block groups.
+
+   The device is divided into groups of GROUP_SECTORS sectors,
+   each summarized by its number of free sectors and by how many
+   runs of free sectors it has of each order, where a run of N
+   sectors has order floor(log2(N)).  Runs are cut at group
+   boundaries.  An allocation starts in the group of a goal
+   sector chosen by the caller, such as the parent directory of
+   a new inode or the inode of new data, and moves on group by
+   group, skipping any group whose summary shows it cannot
+   satisfy the request without looking at its bits.  Each change
+   to the free map updates the summary of the run it touches, so
+   no group is ever rescanned. */
+#define GROUP_SECTORS 1024
+#define ORDER_CNT 11                 /* Orders of 1...GROUP_SECTORS. */
+
+struct group
+  {
+    size_t free_cnt;                 /* Free sectors. */
+    uint16_t runs[ORDER_CNT];        /* Free runs of each order. */
+  };
+
+static struct group *groups;         /* Summary of each group. */
+static size_t group_cnt;             /* Number of groups. */
+
+/* Returns the first sector in group G. */
+static block_sector_t
+group_start (size_t g)
+{
+  return g * GROUP_SECTORS;
+}
+
+/* Returns the sector just past the end of group G. */
+static block_sector_t
+group_end (size_t g)
+{
+  size_t end = (g + 1) * GROUP_SECTORS;
+  return end < bitmap_size (free_map) ? end : bitmap_size (free_map);
+}
+
+/* Returns the order of a run of LENGTH sectors, which must be
+   between 1 and GROUP_SECTORS. */
+static int
+run_order (size_t length)
+{
+  int order = 0;
+
+  ASSERT (length > 0 && length <= GROUP_SECTORS);
+  while (length >>= 1)
+    order++;
+  return order;
+}
+
+/* Adds DELTA to the count of runs of LENGTH free sectors in
+   group GRP.  Does nothing if LENGTH is 0. */
+static void
+count_run (struct group *grp, size_t length, int delta)
+{
+  if (length > 0)
+    grp->runs[run_order (length)] += delta;
+}
+
+/* Recomputes the summaries of all the groups from the free map. */
+static void
+summarize_groups (void)
+{
+  size_t g;
+
+  for (g = 0; g < group_cnt; g++)
+    {
+      struct group *grp = &groups[g];
+      block_sector_t sector;
+      size_t run = 0;
+
+      grp->free_cnt = 0;
+      memset (grp->runs, 0, sizeof grp->runs);
+      for (sector = group_start (g); sector < group_end (g); sector++)
+        if (!bitmap_test (free_map, sector))
+          {
+            grp->free_cnt++;
+            run++;
+          }
+        else
+          {
+            count_run (grp, run, 1);
+            run = 0;
+          }
+      count_run (grp, run, 1);
+    }
+}
+
+/* Returns true if group G may hold a run of CNT free sectors:
+   it certainly does if it has a run of a higher order than CNT,
+   and may if it has one of the same order. */
+static bool
+group_may_fit (size_t g, size_t cnt)
+{
+  struct group *grp = &groups[g];
+  int order;
+
+  if (grp->free_cnt < cnt || cnt > GROUP_SECTORS)
+    return false;
+  for (order = ORDER_CNT - 1; order > run_order (cnt); order--)
+    if (grp->runs[order] > 0)
+      return true;
+  return grp->runs[order] > 0;
+}
+
+/* Marks the CNT sectors starting at SECTOR as allocated if
+   ALLOCATED is true, or as free otherwise, keeping the group
+   summaries and the free map file's dirty sectors up to date.
+   The sectors must all be in the opposite state. */
+static void
+set_sectors (block_sector_t sector, size_t cnt, bool allocated)
+{
+  block_sector_t end = sector + cnt;
+
+  bitmap_set_multiple (free_map, sector, cnt, allocated);
+  mark_dirty (sector, cnt);
+  while (sector < end)
+    {
+      size_t g = sector / GROUP_SECTORS;
+      struct group *grp = &groups[g];
+      block_sector_t piece_end = group_end (g) < end ? group_end (g) : end;
+      size_t n = piece_end - sector;
+      size_t left = 0, right = 0;
+
+      /* The free runs just before and just after the piece, which
+         it splits (allocation) or joins (release). */
+      while (sector - left > group_start (g)
+             && !bitmap_test (free_map, sector - left - 1))
+        left++;
+      while (piece_end + right < group_end (g)
+             && !bitmap_test (free_map, piece_end + right))
+        right++;
+
+      if (allocated)
+        {
+          grp->free_cnt -= n;
+          count_run (grp, left + n + right, -1);
+          count_run (grp, left, 1);
+          count_run (grp, right, 1);
+        }
+      else
+        {
+          grp->free_cnt += n;
+          count_run (grp, left, -1);
+          count_run (grp, right, -1);
+          count_run (grp, left + n + right, 1);
+        }
+      sector = piece_end;
+    }
+}
+
+/* Returns the first sector of a run of CNT free sectors that
+   starts in group G at or after sector START, or BITMAP_ERROR if
+   there is none.  The run may extend past the end of G.  Looks
+   at each sector once. */
+static size_t
+scan_group (size_t g, block_sector_t start, size_t cnt)
+{
+  size_t sector;
+  size_t run = 0;
+
+  for (sector = start;
+       sector - run < group_end (g) && sector < bitmap_size (free_map);
+       sector++)
+    if (bitmap_test (free_map, sector))
+      run = 0;
+    else if (++run == cnt)
+      return sector + 1 - cnt;
+  return BITMAP_ERROR;
+}
+/* === ADD END p4q10 ===*/
 
 /* Initializes the free map. */
 void
@@ -17,37 +240,209 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  /* === ADD START p4q12 ===*/
+  if (bitmap_size (free_map) >= JOURNAL_SECTOR + JOURNAL_SECTORS)
+    bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  /* === ADD END p4q12 ===*/
+  /* === ADD p4q11 === */
+  lock_init (&free_map_lock);
+  /* === ADD START p4q9 ===*/
+  dirty_map = bitmap_create (DIV_ROUND_UP (bitmap_size (free_map),
+                                           BITS_PER_SECTOR));
+  if (dirty_map == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  /* === ADD END p4q9 ===*/
+  /* === ADD START p4q12 ===*/
+  released = bitmap_create (bitmap_size (free_map));
+  if (released == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  /* === ADD END p4q12 ===*/
+  /* === ADD START p4q10 ===*/
+  group_cnt = DIV_ROUND_UP (bitmap_size (free_map), GROUP_SECTORS);
+  groups = malloc (group_cnt * sizeof *groups);
+  if (groups == NULL)
+    PANIC ("can't allocate block group summaries");
+  summarize_groups ();
+  /* === ADD END p4q10 ===*/
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  /* === MODIFY p4q10 === */
+  return free_map_allocate_near (cnt, 0, sectorp);
+}
+
+/* === ADD START p4q10 ===*/
+/* Allocates CNT consecutive sectors from the free map, as close
+   after sector GOAL as possible, and stores the first into
+   *SECTORP.
+   Returns true if successful, false if not enough consecutive
+   sectors were available. */
+bool
+free_map_allocate_near (size_t cnt, block_sector_t goal,
+                        block_sector_t *sectorp)
+{
+  size_t sector = BITMAP_ERROR;
+  size_t i;
+
+  if (goal >= bitmap_size (free_map))
+    goal = 0;
+
+  /* === ADD p4q11 === */
+  lock_acquire (&free_map_lock);
+
+  /* Look for a run within one group, starting from GOAL's. */
+  for (i = 0; i < group_cnt && sector == BITMAP_ERROR; i++)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      size_t g = (goal / GROUP_SECTORS + i) % group_cnt;
+
+      if (!group_may_fit (g, cnt))
+        continue;
+      if (i == 0)
+        sector = scan_group (g, goal, cnt);
+      if (sector == BITMAP_ERROR)
+        sector = scan_group (g, group_start (g), cnt);
     }
+
+  /* A run longer than a group, or split between groups, takes a
+     scan of the whole map. */
+  if (sector == BITMAP_ERROR)
+    sector = bitmap_scan (free_map, 0, cnt, false);
+
   if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+    {
+      set_sectors (sector, cnt, true);
+      *sectorp = sector;
+    }
+  /* === ADD p4q11 === */
+  lock_release (&free_map_lock);
   return sector != BITMAP_ERROR;
 }
+/* === ADD END p4q10 ===*/
+
+/* === ADD START p4q5 ===*/
+/* Allocates the CNT consecutive sectors starting at SECTOR.
+   Returns true if successful, false if any of them is in use
+   or past the end of the device. */
+bool
+free_map_allocate_at (block_sector_t sector, size_t cnt)
+{
+  /* === MODIFY START p4q11 ===*/
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = (sector + cnt <= bitmap_size (free_map)
+             && bitmap_none (free_map, sector, cnt));
+  /* === MODIFY p4q10 === */
+  if (success)
+    set_sectors (sector, cnt, true);
+  lock_release (&free_map_lock);
+  return success;
+  /* === MODIFY END p4q11 ===*/
+}
+/* === ADD END p4q5 ===*/
 
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  /* === ADD p4q11 === */
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  /* === MODIFY START p4q12 ===*/
+  if (journal_enabled ())
+    {
+      bitmap_set_multiple (released, sector, cnt, true);
+      released_cnt += cnt;
+    }
+  else
+    set_sectors (sector, cnt, false);
+  /* === MODIFY END p4q12 ===*/
+  /* === ADD p4q11 === */
+  lock_release (&free_map_lock);
+}
+
+/* === ADD START p4q12 ===*/
+/* Returns true if sectors have been released since the last
+   flush.  They become free at the next commit, so an operation
+   that failed for lack of space may succeed if it commits with
+   journal_commit() and tries again.  The commit cannot happen
+   from within the operation, which would then be committed only
+   in part. */
+bool
+free_map_has_released (void)
+{
+  bool has_released;
+
+  lock_acquire (&free_map_lock);
+  has_released = released_cnt > 0;
+  lock_release (&free_map_lock);
+  return has_released;
+}
+/* === ADD END p4q12 ===*/
+
+/* === ADD START p4q9 ===*/
+/* Writes the sectors of the free map file that have changed
+   since the last flush.
+
+   A sector is marked clean before it is written, without holding
+   the free map lock during the write.  A change that races with
+   the write marks the sector dirty again, so the next flush
+   writes it. */
+void
+free_map_flush (void)
+{
+  size_t bit_cnt = bitmap_size (free_map);
+  size_t i;
+
+  /* === ADD START p4q12 ===*/
+  /* Free the sectors released since the last flush. */
+  lock_acquire (&free_map_lock);
+  for (i = bitmap_scan (released, 0, 1, true); i != BITMAP_ERROR;
+       i = bitmap_scan (released, i, 1, true))
+    {
+      size_t cnt = 1;
+
+      while (i + cnt < bit_cnt && bitmap_test (released, i + cnt))
+        cnt++;
+      bitmap_set_multiple (released, i, cnt, false);
+      set_sectors (i, cnt, false);
+      i += cnt;
+    }
+  released_cnt = 0;
+  lock_release (&free_map_lock);
+  /* === ADD END p4q12 ===*/
+
+  if (free_map_file == NULL)
+    return;
+  for (i = 0; i < bitmap_size (dirty_map); i++)
+    {
+      /* === MODIFY START p4q11 ===*/
+      size_t start = i * BITS_PER_SECTOR;
+      size_t cnt = bit_cnt - start < BITS_PER_SECTOR
+                   ? bit_cnt - start : BITS_PER_SECTOR;
+      bool dirty;
+
+      lock_acquire (&free_map_lock);
+      dirty = bitmap_test (dirty_map, i);
+      bitmap_reset (dirty_map, i);
+      lock_release (&free_map_lock);
+
+      if (dirty && !bitmap_write_part (free_map, free_map_file, start, cnt))
+        {
+          lock_acquire (&free_map_lock);
+          bitmap_mark (dirty_map, i);
+          lock_release (&free_map_lock);
+        }
+      /* === MODIFY END p4q11 ===*/
+    }
 }
+/* === ADD END p4q9 ===*/
 
 /* Opens the free map file and reads it from disk. */
 void
@@ -56,15 +451,23 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  /* === ADD p4q12 === */
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  /* === ADD p4q10 === */
+  summarize_groups ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) 
 {
+  /* === ADD p4q9 === */
+  free_map_flush ();
   file_close (free_map_file);
+  /* === ADD p4q9 === */
+  free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -80,6 +483,10 @@ free_map_create (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  /* === ADD p4q12 === */
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+  /* === ADD p4q9 === */
+  bitmap_set_all (dirty_map, false);
 }
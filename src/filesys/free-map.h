@@ -12,6 +12,14 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
+/* === ADD p4q10 === */
+bool free_map_allocate_near (size_t, block_sector_t goal, block_sector_t *);
+/* === ADD p4q5 === */
+bool free_map_allocate_at (block_sector_t, size_t);
 void free_map_release (block_sector_t, size_t);
+/* === ADD p4q9 === */
+void free_map_flush (void);
+/* === ADD p4q12 === */
+bool free_map_has_released (void);
 
 #endif /* filesys/free-map.h */
@@ -1,25 +1,107 @@
 #include "filesys/inode.h"
-#include <list.h>
+/* === ADD p4q20 === */
+#include <iovec.h>
+/* === MODIFY p4q6 === */
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+/* === ADD p4q11 === */
+#include "threads/synch.h"
+/* === ADD START p4q1 ===*/
+#include "filesys/cache.h"
+/* === ADD END p4q1 ===*/
 
-/* Identifies an inode. */
-#define INODE_MAGIC 0x494e4f44
+/* === MODIFY START p4q5 ===*/
+/* Identify an inode and its on-disk layout.  The block index
+   moved when the layouts came to share struct inode_disk, so it
+   has a magic of its own, different from the "INDX" of the
+   earlier indexed inodes, whose index started in the first word
+   and had one more direct pointer.  Those are not read. */
+#define CONTIGUOUS_MAGIC 0x494e4f44     /* "INOD", original layout. */
+#define INDEXED_MAGIC 0x494e4432        /* "IND2", block index. */
+#define EXTENT_MAGIC 0x494e4558         /* "INEX", extent list. */
 
-/* On-disk inode.
+/* Block pointers held directly in an indexed inode, and the
+   number of pointers that fit in one index sector. */
+#define DIRECT_CNT 122
+#define PTRS_PER_SECTOR (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+
+/* Extents held directly in an extent inode, and in each of its
+   overflow sectors. */
+#define INODE_EXTENT_CNT 61
+#define OVERFLOW_EXTENT_CNT 63
+
+/* Largest number of sectors to preallocate past the end of a
+   growing extent-based file. */
+#define PREALLOC_MAX 64
+
+/* A run of LENGTH contiguous sectors starting at START. */
+struct extent
+  {
+    block_sector_t start;               /* First sector. */
+    uint32_t length;                    /* Number of sectors. */
+  };
+
+/* Multi-level block index.  DIRECT_CNT direct pointers, then
+   one indirect, one doubly indirect and one triply indirect
+   index sector, which together cover more than 1 GB, the
+   largest disk the IDE driver will use.  A pointer of 0 means
+   that no sector has been allocated yet; sector 0 holds the
+   free map inode, so it is never a data or index sector. */
+struct inode_index
+  {
+    block_sector_t direct[DIRECT_CNT];  /* Direct data sectors. */
+    block_sector_t indirect;            /* Indirect index sector. */
+    block_sector_t doubly_indirect;     /* Doubly indirect index sector. */
+    block_sector_t triply_indirect;     /* Triply indirect index sector. */
+  };
+
+/* Extent list.  The first INODE_EXTENT_CNT extents are kept in
+   the inode, the rest in a chain of overflow sectors, each a
+   struct extent_sector.  A file's data is its extents' sectors
+   in order, with no holes. */
+struct inode_extents
+  {
+    uint32_t extent_cnt;                /* Number of extents in use. */
+    block_sector_t overflow;            /* First overflow sector, or 0. */
+    struct extent extents[INODE_EXTENT_CNT];
+  };
+
+/* Overflow sector of an extent list.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct extent_sector
+  {
+    block_sector_t next;                /* Next overflow sector, or 0. */
+    uint32_t unused;                    /* Not used. */
+    struct extent extents[OVERFLOW_EXTENT_CNT];
+  };
+
+/* On-disk inode.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+   MAGIC tells which layout the inode uses. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
+    block_sector_t start;               /* Contiguous: first data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    union
+      {
+        struct inode_index index;       /* INDEXED_MAGIC. */
+        struct inode_extents extents;   /* EXTENT_MAGIC. */
+        uint32_t unused[125];           /* CONTIGUOUS_MAGIC: not used. */
+      }
+    u;
   };
 
+/* Layout used for newly created inodes. */
+static unsigned new_inode_magic = INDEXED_MAGIC;
+/* === MODIFY END p4q5 ===*/
+
 /* Returns the number of sectors to allocate for an inode SIZE
    bytes long. */
 static inline size_t
@@ -31,39 +113,592 @@ bytes_to_sectors (off_t size)
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
+    /* === MODIFY p4q6 === */
+    struct hash_elem elem;              /* Element in open_inodes. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
+    /* === ADD START p4q11 ===*/
+    struct rwlock data_lock;            /* Held to read or write data. */
+    struct lock lock;                   /* Protects the members below. */
+    /* === ADD END p4q11 ===*/
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
+    /* === ADD p4q12 === */
+    bool metadata;                      /* Journal writes to data? */
+    /* === ADD p4q11 === */
+    struct lock dir_lock;               /* Serializes directory operations. */
+    /* === ADD START p4q11 ===*/
+    bool busy;                          /* Being read in or written back? */
+    struct condition ready;             /* Signaled when BUSY goes false. */
+    /* === ADD END p4q11 ===*/
   };
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/* === MODIFY START p4q4 ===*/
+/* A sector's worth of zeros, used to initialize new sectors. */
+static char zeros[BLOCK_SECTOR_SIZE];
+
+/* Returns the sector that block pointer *SLOT refers to.
+   If *SLOT is unallocated and CREATE is true, first allocates
+   a zeroed sector, as close after GOAL as possible, and stores
+   it into *SLOT.  The sector is zeroed before it is stored, so
+   that a concurrent reader never sees its old contents.
+   Returns 0 if there is no sector and none could be allocated. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+get_block (block_sector_t *slot, bool create, block_sector_t goal)
 {
-  ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+  /* === MODIFY START p4q11 ===*/
+  block_sector_t sector;
+
+  if (*slot == 0 && create && free_map_allocate_near (1, goal, &sector))
+    {
+      cache_write (sector, zeros);
+      barrier ();
+      *slot = sector;
+    }
+  return *slot;
+  /* === MODIFY END p4q11 ===*/
+}
+
+/* Returns the sector that pointer IDX of index sector BLOCK
+   refers to, allocating it near BLOCK as in get_block() if
+   CREATE is true.
+   Returns 0 if BLOCK is 0 or if there is no such sector. */
+static block_sector_t
+get_indirect (block_sector_t block, size_t idx, bool create)
+{
+  block_sector_t sector;
+
+  if (block == 0)
+    return 0;
+  cache_read_at (block, &sector, idx * sizeof sector, sizeof sector);
+  if (sector == 0 && get_block (&sector, create, block) != 0)
+    /* === MODIFY p4q12 === */
+    cache_write_meta_at (block, &sector, idx * sizeof sector, sizeof sector);
+  return sector;
+}
+
+/* Returns the sector that holds data sector IDX of indexed
+   inode DISK_INODE, allocating it and the index sectors needed
+   to reach it, near GOAL, if CREATE is true. */
+static block_sector_t
+index_to_sector (struct inode_disk *disk_inode, size_t idx, bool create,
+                 block_sector_t goal)
+{
+  struct inode_index *index = &disk_inode->u.index;
+  const size_t ptrs = PTRS_PER_SECTOR;
+  block_sector_t block;
+
+  if (idx < DIRECT_CNT)
+    return get_block (&index->direct[idx], create, goal);
+  idx -= DIRECT_CNT;
+
+  if (idx < ptrs)
+    {
+      block = get_block (&index->indirect, create, goal);
+      return get_indirect (block, idx, create);
+    }
+  idx -= ptrs;
+
+  if (idx < ptrs * ptrs)
+    {
+      block = get_block (&index->doubly_indirect, create, goal);
+      block = get_indirect (block, idx / ptrs, create);
+      return get_indirect (block, idx % ptrs, create);
+    }
+  idx -= ptrs * ptrs;
+
+  if (idx < ptrs * ptrs * ptrs)
+    {
+      block = get_block (&index->triply_indirect, create, goal);
+      block = get_indirect (block, idx / (ptrs * ptrs), create);
+      block = get_indirect (block, idx / ptrs % ptrs, create);
+      return get_indirect (block, idx % ptrs, create);
+    }
+  return 0;
+}
+
+/* Releases index or data sector BLOCK, if allocated.  LEVEL is
+   the number of levels of index below BLOCK, whose sectors are
+   released first. */
+static void
+release_blocks (block_sector_t block, int level)
+{
+  if (block == 0)
+    return;
+  if (level > 0)
+    {
+      size_t i;
+
+      for (i = 0; i < PTRS_PER_SECTOR; i++)
+        release_blocks (get_indirect (block, i, false), level - 1);
+    }
+  free_map_release (block, 1);
+}
+/* === MODIFY END p4q4 ===*/
+
+/* === ADD START p4q5 ===*/
+/* Returns the overflow sector that holds extent IDX of extent
+   inode DISK_INODE, allocating it and the overflow sectors
+   before it near GOAL if CREATE is true, and stores the byte
+   offset of the extent within the sector into *OFS.
+   Returns 0 if there is no such sector. */
+static block_sector_t
+overflow_sector (struct inode_disk *disk_inode, size_t idx, bool create,
+                 block_sector_t goal, int *ofs)
+{
+  block_sector_t sector;
+  size_t i;
+
+  idx -= INODE_EXTENT_CNT;
+  sector = get_block (&disk_inode->u.extents.overflow, create, goal);
+  for (i = idx / OVERFLOW_EXTENT_CNT; i > 0; i--)
+    sector = get_indirect (sector, 0, create);
+  *ofs = (offsetof (struct extent_sector, extents)
+          + idx % OVERFLOW_EXTENT_CNT * sizeof (struct extent));
+  return sector;
+}
+
+/* Reads extent IDX of DISK_INODE into *E. */
+static void
+get_extent (struct inode_disk *disk_inode, size_t idx, struct extent *e)
+{
+  if (idx < INODE_EXTENT_CNT)
+    *e = disk_inode->u.extents.extents[idx];
   else
-    return -1;
+    {
+      int ofs;
+      block_sector_t sector;
+
+      sector = overflow_sector (disk_inode, idx, false, 0, &ofs);
+      ASSERT (sector != 0);
+      cache_read_at (sector, e, ofs, sizeof *e);
+    }
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Stores E as extent IDX of DISK_INODE, allocating an overflow
+   sector for it near GOAL if necessary.
+   Returns true if successful, false if the disk is full. */
+static bool
+put_extent (struct inode_disk *disk_inode, size_t idx, const struct extent *e,
+            block_sector_t goal)
+{
+  if (idx < INODE_EXTENT_CNT)
+    disk_inode->u.extents.extents[idx] = *e;
+  else
+    {
+      int ofs;
+      block_sector_t sector;
+
+      sector = overflow_sector (disk_inode, idx, true, goal, &ofs);
+      if (sector == 0)
+        return false;
+      /* === MODIFY p4q12 === */
+      cache_write_meta_at (sector, e, ofs, sizeof *e);
+    }
+  return true;
+}
+
+/* Adds at least CNT sectors to the end of extent inode
+   DISK_INODE, which currently has MAPPED sectors.  A file that
+   keeps growing gets up to PREALLOC_MAX sectors more than it
+   asked for, so that its data stays in a few long extents.  A
+   run that directly follows the last extent extends it; failing
+   that, new runs are placed near the last extent, or near GOAL
+   for an empty file.
+   Returns true if successful, false if the disk filled up
+   first, in which case some sectors may have been added. */
+static bool
+extent_grow (struct inode_disk *disk_inode, size_t mapped, size_t cnt,
+             block_sector_t goal)
+{
+  struct inode_extents *extents = &disk_inode->u.extents;
+  size_t want = mapped < PREALLOC_MAX ? mapped : PREALLOC_MAX;
+
+  if (want < cnt)
+    want = cnt;
+  while (cnt > 0)
+    {
+      struct extent last;
+      block_sector_t start;
+      size_t n;
+
+      last.start = last.length = 0;
+      if (extents->extent_cnt > 0)
+        get_extent (disk_inode, extents->extent_cnt - 1, &last);
+      /* === ADD p4q10 === */
+      if (last.length > 0)
+        goal = last.start + last.length;
+
+      /* Find the longest run up to WANT sectors, preferring one
+         right after the last extent. */
+      for (n = want; n > 0; n /= 2)
+        {
+          start = last.start + last.length;
+          if (last.length > 0 && free_map_allocate_at (start, n))
+            break;
+          /* === MODIFY p4q10 === */
+          if (free_map_allocate_near (n, goal, &start))
+            break;
+        }
+      if (n == 0)
+        return false;
+      /* === MODIFY p4q13 === */
+      cache_zero (start, n);
+
+      if (last.length > 0 && start == last.start + last.length)
+        {
+          last.length += n;
+          put_extent (disk_inode, extents->extent_cnt - 1, &last, goal);
+        }
+      else
+        {
+          struct extent e;
+
+          e.start = start;
+          e.length = n;
+          if (!put_extent (disk_inode, extents->extent_cnt, &e, goal))
+            {
+              free_map_release (start, n);
+              return false;
+            }
+          extents->extent_cnt++;
+        }
+
+      /* Preallocation is best effort: once the disk is too
+         fragmented to supply it, ask only for what is needed. */
+      cnt = cnt > n ? cnt - n : 0;
+      want = cnt;
+    }
+  return true;
+}
+
+/* Returns the sector that holds data sector IDX of extent inode
+   DISK_INODE, first growing the file to include it, near GOAL,
+   if CREATE is true. */
+static block_sector_t
+extent_to_sector (struct inode_disk *disk_inode, size_t idx, bool create,
+                  block_sector_t goal)
+{
+  size_t mapped = 0;
+  size_t i;
+
+  for (i = 0; i < disk_inode->u.extents.extent_cnt; i++)
+    {
+      struct extent e;
+
+      get_extent (disk_inode, i, &e);
+      if (idx < mapped + e.length)
+        return e.start + (idx - mapped);
+      mapped += e.length;
+    }
+
+  if (create && extent_grow (disk_inode, mapped, idx - mapped + 1, goal))
+    return extent_to_sector (disk_inode, idx, false, 0);
+  return 0;
+}
+
+/* Releases the sectors that extent inode DISK_INODE has
+   preallocated past the end of its data.
+   Returns true if DISK_INODE changed, false if there was
+   nothing to release. */
+static bool
+extent_trim (struct inode_disk *disk_inode)
+{
+  struct inode_extents *extents = &disk_inode->u.extents;
+  size_t needed = bytes_to_sectors (disk_inode->length);
+  size_t mapped = 0;
+  bool trimmed = false;
+  size_t i;
+
+  for (i = 0; i < extents->extent_cnt; i++)
+    {
+      struct extent e;
+
+      get_extent (disk_inode, i, &e);
+      if (mapped + e.length > needed)
+        {
+          size_t keep = needed > mapped ? needed - mapped : 0;
+
+          free_map_release (e.start + keep, e.length - keep);
+          e.length = keep;
+          put_extent (disk_inode, i, &e, 0);
+          trimmed = true;
+        }
+      mapped += e.length;
+    }
+  /* Drop the extents that are now empty.  Their overflow
+     sectors stay allocated until the inode is deallocated. */
+  while (extents->extent_cnt > 0)
+    {
+      struct extent e;
+
+      get_extent (disk_inode, extents->extent_cnt - 1, &e);
+      if (e.length > 0)
+        break;
+      extents->extent_cnt--;
+    }
+  return trimmed;
+}
+/* === ADD END p4q5 ===*/
+
+/* === MODIFY START p4q5 ===*/
+/* Returns the block device sector that contains byte offset POS
+   within the file described by DISK_INODE.
+   Returns 0 if no sector has been allocated for POS.  If CREATE
+   is true, first allocates the data sector and any index sectors
+   needed to reach it, as close after GOAL as possible; then 0 is
+   returned only if the disk is full, POS is past the largest
+   possible file, or DISK_INODE uses the contiguous layout, which
+   cannot grow.  New pointers in DISK_INODE itself are only
+   updated in memory, so the caller must write DISK_INODE back. */
+static block_sector_t
+map_sector (struct inode_disk *disk_inode, off_t pos, bool create,
+            block_sector_t goal) 
+{
+  size_t idx;
+
+  ASSERT (disk_inode != NULL);
+  ASSERT (pos >= 0);
+
+  idx = pos / BLOCK_SECTOR_SIZE;
+  switch (disk_inode->magic)
+    {
+    case CONTIGUOUS_MAGIC:
+      if (idx < bytes_to_sectors (disk_inode->length))
+        return disk_inode->start + idx;
+      return 0;
+
+    case INDEXED_MAGIC:
+      return index_to_sector (disk_inode, idx, create, goal);
+
+    case EXTENT_MAGIC:
+      return extent_to_sector (disk_inode, idx, create, goal);
+
+    default:
+      NOT_REACHED ();
+    }
+}
+
+/* Returns the block device sector that contains byte offset POS
+   within the file described by DISK_INODE, or 0 if no sector has
+   been allocated for POS. */
+static block_sector_t
+byte_to_sector (struct inode_disk *disk_inode, off_t pos)
+{
+  return map_sector (disk_inode, pos, false, 0);
+}
+
+/* Releases all of the data, index and overflow sectors of
+   DISK_INODE. */
+static void
+deallocate (struct inode_disk *disk_inode)
+{
+  block_sector_t sector;
+  size_t i;
+
+  switch (disk_inode->magic)
+    {
+    case CONTIGUOUS_MAGIC:
+      if (disk_inode->length > 0)
+        free_map_release (disk_inode->start,
+                          bytes_to_sectors (disk_inode->length));
+      break;
+
+    case INDEXED_MAGIC:
+      for (i = 0; i < DIRECT_CNT; i++)
+        release_blocks (disk_inode->u.index.direct[i], 0);
+      release_blocks (disk_inode->u.index.indirect, 1);
+      release_blocks (disk_inode->u.index.doubly_indirect, 2);
+      release_blocks (disk_inode->u.index.triply_indirect, 3);
+      break;
+
+    case EXTENT_MAGIC:
+      for (i = 0; i < disk_inode->u.extents.extent_cnt; i++)
+        {
+          struct extent e;
+
+          get_extent (disk_inode, i, &e);
+          if (e.length > 0)
+            free_map_release (e.start, e.length);
+        }
+      for (sector = disk_inode->u.extents.overflow; sector != 0; )
+        {
+          block_sector_t next = get_indirect (sector, 0, false);
+          free_map_release (sector, 1);
+          sector = next;
+        }
+      break;
+
+    default:
+      NOT_REACHED ();
+    }
+}
+
+/* Allocates the first SECTORS data sectors of the new inode
+   DISK_INODE, as close after GOAL as possible, and fills them
+   with zeros.
+   Returns true if successful.  Returns false if the disk is
+   full, in which case nothing stays allocated. */
+static bool
+allocate (struct inode_disk *disk_inode, size_t sectors,
+          block_sector_t goal)
+{
+  size_t i;
+
+  if (sectors == 0)
+    return true;
+  switch (disk_inode->magic)
+    {
+    case CONTIGUOUS_MAGIC:
+      if (!free_map_allocate_near (sectors, goal, &disk_inode->start))
+        return false;
+      /* === MODIFY p4q13 === */
+      cache_zero (disk_inode->start, sectors);
+      return true;
+
+    case INDEXED_MAGIC:
+      /* Sectors need not be contiguous, so allocate them one at
+         a time. */
+      for (i = 0; i < sectors; i++)
+        if (index_to_sector (disk_inode, i, true, goal) == 0)
+          {
+            deallocate (disk_inode);
+            return false;
+          }
+      return true;
+
+    case EXTENT_MAGIC:
+      if (!extent_grow (disk_inode, 0, sectors, goal))
+        {
+          deallocate (disk_inode);
+          return false;
+        }
+      return true;
+
+    default:
+      NOT_REACHED ();
+    }
+}
+
+/* === MODIFY END p4q5 ===*/
+
+/* === MODIFY START p4q6 ===*/
+/* Open inodes, hashed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
+
+/* === ADD START p4q11 ===*/
+/* Protects open_inodes, the statistics below, and each open
+   inode's OPEN_CNT, REMOVED, and BUSY members.  No disk I/O is
+   done while it is held: an inode that is being read in or
+   written back stays in open_inodes marked busy, and whoever
+   opens it meanwhile waits on it for the I/O to finish. */
+static struct lock open_inodes_lock;
+
+/* Waits until INODE is not busy.
+   open_inodes_lock must be held. */
+static void
+wait_until_ready (struct inode *inode)
+{
+  while (inode->busy)
+    cond_wait (&inode->ready, &open_inodes_lock);
+}
+
+/* Marks INODE as no longer busy and wakes up its waiters.
+   open_inodes_lock must be held. */
+static void
+make_ready (struct inode *inode)
+{
+  inode->busy = false;
+  cond_broadcast (&inode->ready, &open_inodes_lock);
+}
+/* === ADD END p4q11 ===*/
+
+/* Statistics. */
+static unsigned long long lookup_cnt;  /* Calls to inode_open(). */
+static unsigned long long reopen_cnt;  /* ...that found the inode open. */
+static unsigned long long compare_cnt; /* Key comparisons in open_inodes. */
+
+static unsigned inode_hash (const struct hash_elem *, void *);
+static bool inode_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
+  if (!hash_init (&open_inodes, inode_hash, inode_less, NULL))
+    PANIC ("can't allocate open inode table");
+  /* === ADD p4q11 === */
+  lock_init (&open_inodes_lock);
 }
 
+/* Prints inode statistics. */
+void
+inode_print_stats (void)
+{
+  printf ("Inodes: %llu opens, %llu already open, %llu key comparisons\n",
+          lookup_cnt, reopen_cnt, compare_cnt);
+}
+
+/* Returns a hash value for the inode that E is embedded in. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+/* Returns true if the inode that A is embedded in precedes the
+   one that B is embedded in. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  compare_cnt++;
+  return (hash_entry (a, struct inode, elem)->sector
+          < hash_entry (b, struct inode, elem)->sector);
+}
+/* === MODIFY END p4q6 ===*/
+
+/* === ADD START p4q5 ===*/
+/* Makes newly created inodes use the layout named NAME:
+   "indexed" (the default), "extent" or "contiguous".
+   Returns false if NAME is not one of these. */
+bool
+inode_set_format (const char *name)
+{
+  if (!strcmp (name, "indexed"))
+    new_inode_magic = INDEXED_MAGIC;
+  else if (!strcmp (name, "extent"))
+    new_inode_magic = EXTENT_MAGIC;
+  else if (!strcmp (name, "contiguous"))
+    new_inode_magic = CONTIGUOUS_MAGIC;
+  else
+    return false;
+  return true;
+}
+
+/* Makes newly created inodes use the same layout as the inode
+   in SECTOR, so that a file system keeps the format it was
+   created with.  Panics if the layout is not one this kernel
+   reads. */
+void
+inode_use_format_of (block_sector_t sector)
+{
+  unsigned magic;
+
+  cache_read_at (sector, &magic, offsetof (struct inode_disk, magic),
+                 sizeof magic);
+  if (magic == CONTIGUOUS_MAGIC || magic == INDEXED_MAGIC
+      || magic == EXTENT_MAGIC)
+    new_inode_magic = magic;
+  else
+    PANIC ("unknown inode format %08x in sector %"PRDSNu", "
+           "reformat with -f", magic, sector);
+}
+/* === ADD END p4q5 ===*/
+
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
    device.
@@ -80,26 +715,26 @@ inode_create (block_sector_t sector, off_t length)
   /* If this assertion fails, the inode structure is not exactly
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
+  /* === ADD p4q5 === */
+  ASSERT (sizeof (struct extent_sector) == BLOCK_SECTOR_SIZE);
 
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
       disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
+      /* === MODIFY START p4q5 ===*/
+      disk_inode->magic = new_inode_magic;
+
+      /* The free map file relies on being fully allocated here,
+         since growing it would need the free map. */
+      /* Data goes near its inode. */
+      if (allocate (disk_inode, bytes_to_sectors (length), sector))
         {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
+          /* === MODIFY p4q12 === */
+          cache_write_meta (sector, disk_inode);
+          success = true;
+        }
+      /* === MODIFY END p4q5 ===*/
       free (disk_inode);
     }
   return success;
@@ -111,33 +746,60 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  /* === MODIFY START p4q6 ===*/
+  struct inode key;
+  struct hash_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  /* === MODIFY START p4q11 ===*/
+  lock_acquire (&open_inodes_lock);
+  lookup_cnt++;
+  key.sector = sector;
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      reopen_cnt++;
+      inode = hash_entry (e, struct inode, elem);
+      inode->open_cnt++;
+      wait_until_ready (inode);
+      lock_release (&open_inodes_lock);
+      return inode; 
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize.  The inode goes into open_inodes busy, so that
+     whoever opens it before it has been read waits for it. */
+  /* === MODIFY END p4q6 ===*/
   inode->sector = sector;
+  /* === ADD p4q6 === */
+  hash_insert (&open_inodes, &inode->elem);
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  /* === ADD p4q12 === */
+  inode->metadata = false;
+  rwlock_init (&inode->data_lock);
+  lock_init (&inode->lock);
+  lock_init (&inode->dir_lock);
+  inode->busy = true;
+  cond_init (&inode->ready);
+  lock_release (&open_inodes_lock);
+
+  /* === MODIFY p4q1 === */
+  cache_read (inode->sector, &inode->data);
+
+  lock_acquire (&open_inodes_lock);
+  make_ready (inode);
+  lock_release (&open_inodes_lock);
+  /* === MODIFY END p4q11 ===*/
   return inode;
 }
 
@@ -146,7 +808,13 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      /* === MODIFY START p4q11 ===*/
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+      /* === MODIFY END p4q11 ===*/
+    }
   return inode;
 }
 
@@ -168,21 +836,50 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  /* === MODIFY START p4q11 ===*/
+  lock_acquire (&open_inodes_lock);
+  if (--inode->open_cnt > 0)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
-      /* Deallocate blocks if removed. */
-      if (inode->removed) 
+      lock_release (&open_inodes_lock);
+      return;
+    }
+
+  /* === ADD START p4q5 ===*/
+  /* Give back what the file did not grow into.  The inode stays
+     in open_inodes, busy, while it is trimmed, so that whoever
+     opens it meanwhile waits and then gets it back trimmed. */
+  if (!inode->removed && inode->data.magic == EXTENT_MAGIC)
+    {
+      inode->busy = true;
+      lock_release (&open_inodes_lock);
+      if (extent_trim (&inode->data))
+        /* === MODIFY p4q12 === */
+        cache_write_meta (inode->sector, &inode->data);
+      lock_acquire (&open_inodes_lock);
+      make_ready (inode);
+      if (inode->open_cnt > 0)
         {
-          free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          lock_release (&open_inodes_lock);
+          return;
         }
+    }
+  /* === ADD END p4q5 ===*/
+
+  /* Remove from inode list and release lock. */
+  /* === MODIFY p4q6 === */
+  hash_delete (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
 
-      free (inode); 
+  /* Deallocate blocks if removed. */
+  if (inode->removed) 
+    {
+      free_map_release (inode->sector, 1);
+      /* === MODIFY p4q4 === */
+      deallocate (&inode->data);
     }
+
+  free (inode); 
+  /* === MODIFY END p4q11 ===*/
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -191,128 +888,274 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  /* === MODIFY START p4q11 ===*/
+  lock_acquire (&open_inodes_lock);
   inode->removed = true;
+  lock_release (&open_inodes_lock);
+  /* === MODIFY END p4q11 ===*/
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) 
+{
+  /* === MODIFY START p4q20 ===*/
+  struct iovec iov;
+
+  iov.iov_base = buffer;
+  iov.iov_len = size;
+  return inode_readv_at (inode, &iov, 1, offset);
+  /* === MODIFY END p4q20 ===*/
+}
+
+/* === ADD START p4q20 ===*/
+/* Reads from INODE, starting at position OFFSET, into the IOV_CNT
+   segments of IOV, filling each before going on to the next.
+   Returns the number of bytes actually read, which may be less
+   than the segments' total if an error occurs or end of file is
+   reached. */
+off_t
+inode_readv_at (struct inode *inode, const struct iovec *iov, int iov_cnt,
+                off_t offset)
+/* === ADD END p4q20 ===*/
 {
-  uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+  block_sector_t sector_idx;
+  /* === ADD p4q20 === */
+  int i;
 
-  while (size > 0) 
+  /* === ADD p4q11 === */
+  rwlock_acquire_read (&inode->data_lock);
+  /* === ADD START p4q20 ===*/
+  for (i = 0; i < iov_cnt; i++)
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
-
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
-
-      /* Number of bytes to actually copy out of this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+      uint8_t *buffer = iov[i].iov_base;
+      off_t size = iov[i].iov_len;
+      off_t seg_read = 0;
+  /* === ADD END p4q20 ===*/
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
+      while (size > 0) 
         {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          /* Disk sector to read, starting byte offset within sector. */
+          int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+
+          /* Bytes left in inode, bytes left in sector, lesser of the two. */
+          off_t inode_left = inode_length (inode) - offset;
+          int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+          int min_left = inode_left < sector_left ? inode_left : sector_left;
+
+          /* Number of bytes to actually copy out of this sector. */
+          int chunk_size = size < min_left ? size : min_left;
+          if (chunk_size <= 0)
+            break;
+
+          /* === MODIFY START p4q4 ===*/
+          /* Copy the chunk out of the buffer cache, which takes care
+             of partial sectors for us.  A sector that was never
+             written reads as zeros. */
+          sector_idx = byte_to_sector (&inode->data, offset);
+          /* === MODIFY START p4q20 ===*/
+          if (sector_idx != 0)
+            cache_read_at (sector_idx, buffer + seg_read,
+                           sector_ofs, chunk_size);
+          else
+            memset (buffer + seg_read, 0, chunk_size);
+          /* === MODIFY END p4q20 ===*/
+          /* === MODIFY END p4q4 ===*/
+          
+          /* Advance. */
+          size -= chunk_size;
+          offset += chunk_size;
+          /* === MODIFY p4q20 === */
+          seg_read += chunk_size;
         }
-      
-      /* Advance. */
-      size -= chunk_size;
-      offset += chunk_size;
-      bytes_read += chunk_size;
+  /* === ADD START p4q20 ===*/
+      bytes_read += seg_read;
+      if (size > 0)
+        break;
     }
-  free (bounce);
+  /* === ADD END p4q20 ===*/
+  /* === ADD p4q11 === */
+  rwlock_release_read (&inode->data_lock);
 
   return bytes_read;
 }
 
+/* === ADD START p4q2 ===*/
+/* Starts bringing the sectors that hold the SIZE bytes of INODE
+   at OFFSET into the buffer cache in the background, so that a
+   following inode_read_at() of them will not wait for the disk.
+   Bytes past end of file are ignored. */
+void
+inode_read_ahead (struct inode *inode, off_t offset, off_t size)
+{
+  off_t end = offset + size;
+
+  if (end > inode_length (inode))
+    end = inode_length (inode);
+  /* === ADD p4q11 === */
+  rwlock_acquire_read (&inode->data_lock);
+  for (offset = ROUND_DOWN (offset, BLOCK_SECTOR_SIZE); offset < end;
+       offset += BLOCK_SECTOR_SIZE)
+    {
+      /* === MODIFY START p4q4 ===*/
+      block_sector_t sector = byte_to_sector (&inode->data, offset);
+      if (sector != 0)
+        cache_read_ahead (sector);
+      /* === MODIFY END p4q4 ===*/
+    }
+  /* === ADD p4q11 === */
+  rwlock_release_read (&inode->data_lock);
+}
+/* === ADD END p4q2 ===*/
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up or an error occurs.
+   Writing past end of file extends the inode; only the sectors
+   actually written are allocated, so any gap reads back as
+   zeros.
+
+   Writes within the file share INODE's data lock with readers,
+   since the buffer cache keeps each sector consistent.  A write
+   that extends the file holds it exclusively, so that readers
+   wait for the new data instead of reading the old length. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
                 off_t offset) 
 {
-  const uint8_t *buffer = buffer_;
+  /* === MODIFY START p4q20 ===*/
+  struct iovec iov;
+
+  iov.iov_base = (void *) buffer;
+  iov.iov_len = size;
+  return inode_writev_at (inode, &iov, 1, offset);
+  /* === MODIFY END p4q20 ===*/
+}
+
+/* === ADD START p4q20 ===*/
+/* Writes the IOV_CNT segments of IOV, one after another, into
+   INODE, starting at OFFSET, as inode_write_at() would write them
+   concatenated.  Returns the number of bytes actually written. */
+off_t
+inode_writev_at (struct inode *inode, const struct iovec *iov, int iov_cnt,
+                 off_t offset)
+/* === ADD END p4q20 ===*/
+{
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  /* === ADD p4q4 === */
+  bool allocated = false;
+  /* === ADD p4q11 === */
+  bool extending;
+  /* === ADD START p4q20 ===*/
+  off_t total = 0;
+  int i;
+  /* === ADD END p4q20 ===*/
 
   if (inode->deny_write_cnt)
     return 0;
 
-  while (size > 0) 
+  /* === ADD START p4q11 ===*/
+  /* The length only grows, so a write that fits now still fits
+     once the lock is held. */
+  /* === MODIFY START p4q20 ===*/
+  for (i = 0; i < iov_cnt; i++)
+    total += iov[i].iov_len;
+  extending = offset + total > inode_length (inode);
+  /* === MODIFY END p4q20 ===*/
+  if (extending)
+    rwlock_acquire_write (&inode->data_lock);
+  else
+    rwlock_acquire_read (&inode->data_lock);
+  /* === ADD END p4q11 ===*/
+
+  /* === ADD START p4q20 ===*/
+  for (i = 0; i < iov_cnt; i++)
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
-
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
-      int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
-
-      /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+      const uint8_t *buffer = iov[i].iov_base;
+      off_t size = iov[i].iov_len;
+      off_t seg_written = 0;
+  /* === ADD END p4q20 ===*/
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
+      while (size > 0) 
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
+          /* === MODIFY START p4q4 ===*/
+          /* Sector to write, starting byte offset within sector. */
+          block_sector_t sector_idx = byte_to_sector (&inode->data, offset);
+          int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+
+          /* Bytes left in sector. */
+          int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+
+          /* Number of bytes to actually write into this sector. */
+          int chunk_size = size < sector_left ? size : sector_left;
+
+          /* Allocate the sector if this is its first write. */
+          if (sector_idx == 0)
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
+              /* === MODIFY START p4q11 ===*/
+              lock_acquire (&inode->lock);
+              sector_idx = map_sector (&inode->data, offset, true,
+                                       inode->sector);
+              lock_release (&inode->lock);
+              /* === MODIFY END p4q11 ===*/
+              if (sector_idx == 0)
                 break;
+              allocated = true;
             }
+          /* === MODIFY END p4q4 ===*/
 
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
+          /* === MODIFY START p4q1 ===*/
+          /* The buffer cache preserves the rest of a partially
+             written sector. */
+          /* === MODIFY START p4q12 ===*/
+          /* === MODIFY START p4q20 ===*/
+          if (inode->metadata)
+            cache_write_meta_at (sector_idx, buffer + seg_written,
+                                 sector_ofs, chunk_size);
           else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
+            cache_write_at (sector_idx, buffer + seg_written,
+                            sector_ofs, chunk_size);
+          /* === MODIFY END p4q20 ===*/
+          /* === MODIFY END p4q12 ===*/
+          /* === MODIFY END p4q1 ===*/
+
+          /* Advance. */
+          size -= chunk_size;
+          offset += chunk_size;
+          /* === MODIFY p4q20 === */
+          seg_written += chunk_size;
         }
+  /* === ADD START p4q20 ===*/
+      bytes_written += seg_written;
+      if (size > 0)
+        break;
+    }
+  /* === ADD END p4q20 ===*/
 
-      /* Advance. */
-      size -= chunk_size;
-      offset += chunk_size;
-      bytes_written += chunk_size;
+  /* === ADD START p4q4 ===*/
+  /* Extend the file only after its new data is in place, so that
+     a reader never sees the new length before the data. */
+  /* === ADD p4q11 === */
+  lock_acquire (&inode->lock);
+  if (bytes_written > 0 && offset > inode->data.length)
+    {
+      inode->data.length = offset;
+      allocated = true;
     }
-  free (bounce);
+  if (allocated)
+    /* === MODIFY p4q12 === */
+    cache_write_meta (inode->sector, &inode->data);
+  /* === ADD END p4q4 ===*/
+  /* === ADD START p4q11 ===*/
+  lock_release (&inode->lock);
+  if (extending)
+    rwlock_release_write (&inode->data_lock);
+  else
+    rwlock_release_read (&inode->data_lock);
+  /* === ADD END p4q11 ===*/
 
   return bytes_written;
 }
@@ -322,8 +1165,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  /* === ADD p4q11 === */
+  lock_acquire (&inode->lock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  /* === ADD p4q11 === */
+  lock_release (&inode->lock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +1179,13 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  /* === ADD p4q11 === */
+  lock_acquire (&inode->lock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  /* === ADD p4q11 === */
+  lock_release (&inode->lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -343,3 +1194,41 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* === ADD START p4q11 ===*/
+/* Acquires the lock that serializes operations on directory
+   INODE, so that a lookup never sees an entry half added or
+   removed. */
+void
+inode_lock_dir (struct inode *inode)
+{
+  lock_acquire (&inode->dir_lock);
+}
+
+/* Releases directory INODE's lock. */
+void
+inode_unlock_dir (struct inode *inode)
+{
+  lock_release (&inode->dir_lock);
+}
+/* === ADD END p4q11 ===*/
+
+/* === ADD START p4q12 ===*/
+/* Marks INODE's data as metadata, as for a directory or the free
+   map, so that writes to it go through the journal. */
+void
+inode_set_metadata (struct inode *inode)
+{
+  inode->metadata = true;
+}
+
+/* Returns the most sectors of metadata, besides the inode, that
+   writing LENGTH bytes to an inode can change: in each of the
+   three levels of index sectors, one for every PTRS_PER_SECTOR
+   sectors of data, plus one for a write that straddles two. */
+size_t
+inode_index_sectors (off_t length)
+{
+  return 3 * (DIV_ROUND_UP (bytes_to_sectors (length), PTRS_PER_SECTOR) + 1);
+}
+/* === ADD END p4q12 ===*/
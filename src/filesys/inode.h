@@ -8,6 +8,10 @@
 struct bitmap;
 
 void inode_init (void);
+/* === ADD START p4q5 ===*/
+bool inode_set_format (const char *);
+void inode_use_format_of (block_sector_t);
+/* === ADD END p4q5 ===*/
 bool inode_create (block_sector_t, off_t);
 struct inode *inode_open (block_sector_t);
 struct inode *inode_reopen (struct inode *);
@@ -16,8 +20,28 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+/* === ADD START p4q20 ===*/
+struct iovec;
+off_t inode_readv_at (struct inode *, const struct iovec *, int iov_cnt,
+                      off_t offset);
+off_t inode_writev_at (struct inode *, const struct iovec *, int iov_cnt,
+                       off_t offset);
+/* === ADD END p4q20 ===*/
+/* === ADD START p4q2 ===*/
+void inode_read_ahead (struct inode *, off_t offset, off_t size);
+/* === ADD END p4q2 ===*/
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+/* === ADD p4q6 === */
+void inode_print_stats (void);
+/* === ADD START p4q11 ===*/
+void inode_lock_dir (struct inode *);
+void inode_unlock_dir (struct inode *);
+/* === ADD END p4q11 ===*/
+/* === ADD START p4q12 ===*/
+void inode_set_metadata (struct inode *);
+size_t inode_index_sectors (off_t length);
+/* === ADD END p4q12 ===*/
 
 #endif /* filesys/inode.h */
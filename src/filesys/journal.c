@@ -0,0 +1,755 @@
+/* === ADD START p4q12 ===*/
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Metadata journal.
+
+   Metadata -- inodes, index sectors, directories and the free
+   map -- is not written to its home sectors as it changes.
+   Instead, the buffer cache hands each changed sector to the
+   journal, which keeps the sector's newest contents in memory
+   until they are committed: written to the log, together with
+   every other sector changed since the last commit, as one
+   sequential run of sectors ended by a commit record.  A commit
+   normally happens once a second, so that the scattered metadata
+   writes of many operations become one sequential write (group
+   commit).
+
+   A checkpoint later writes the committed sectors to their home
+   locations, after which the log is reused from its start.  If
+   the system stops before then, journal_init() replays the
+   committed transactions from the log, which takes time bounded
+   by the size of the log.  Either way, each operation is found
+   either entirely done or not done at all.
+
+   File data is not journaled, but each commit first writes the
+   dirty data in the buffer cache to disk, so that committed
+   metadata never refers to data that was never written.
+
+   Operations that change metadata run between journal_begin()
+   and journal_end().  A commit waits for the operations in
+   progress to end and holds off new ones, so that it never
+   records half of an operation.  An operation begun inside
+   another, by the same thread, is part of the outer one.
+
+   A transaction must fit in the journal's memory, so each
+   operation sets aside, when it begins, slots for the metadata
+   sectors it may change, and waits, committing and checkpointing
+   if need be, until there is room for them.  Room is also kept
+   for each commit to write the whole free map.  An operation
+   never finds the journal full, and so all metadata goes through
+   the log. */
+
+/* On-disk layout.  Sector JOURNAL_SECTOR holds a struct
+   journal_header, and the rest of the JOURNAL_SECTORS sectors
+   are the log.  Each transaction in the log is a struct
+   journal_desc that lists the home sectors it changes, then the
+   new contents of those sectors, then a struct journal_commit.
+   Transactions are numbered consecutively, and the header gives
+   the number of the first one in the log, so that a transaction
+   left over from before the last checkpoint is never replayed. */
+#define JOURNAL_MAGIC 0x4a524e4c        /* "JRNL". */
+#define DESC_MAGIC 0x4a445343           /* "JDSC". */
+#define COMMIT_MAGIC 0x4a434d54         /* "JCMT". */
+#define LOG_START (JOURNAL_SECTOR + 1)
+#define LOG_SECTORS (JOURNAL_SECTORS - 1)
+#define DESC_CNT 125
+
+/* Sectors the journal can hold in memory, which is also the
+   largest possible transaction. */
+#define SLOT_CNT 96
+
+/* Size of the running transaction, in sectors, at which the next
+   operation commits it before starting. */
+#define COMMIT_CNT 32
+
+/* Ticks between periodic commits. */
+#define COMMIT_INTERVAL TIMER_FREQ
+
+/* Journal header.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    unsigned magic;                     /* JOURNAL_MAGIC. */
+    uint32_t seq;                       /* First transaction in the log. */
+    uint32_t unused[126];               /* Not used. */
+  };
+
+/* Transaction descriptor.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_desc
+  {
+    unsigned magic;                     /* DESC_MAGIC. */
+    uint32_t seq;                       /* Transaction number. */
+    uint32_t cnt;                       /* Number of sectors. */
+    block_sector_t sectors[DESC_CNT];   /* Home of each sector. */
+  };
+
+/* Commit record.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_commit
+  {
+    unsigned magic;                     /* COMMIT_MAGIC. */
+    uint32_t seq;                       /* Transaction number. */
+    uint32_t cnt;                       /* Number of sectors. */
+    uint32_t checksum;                  /* Checksum of the sectors. */
+    uint32_t unused[124];               /* Not used. */
+  };
+
+/* A sector held by the journal. */
+struct slot
+  {
+    struct hash_elem elem;              /* Element in held. */
+    block_sector_t sector;              /* Home sector. */
+    bool in_use;                        /* Is this slot holding a sector? */
+    bool running;                       /* Changed since the last commit? */
+    uint8_t *data;                      /* Newest contents. */
+  };
+
+static struct slot slots[SLOT_CNT];
+static struct hash held;                /* Slots in use, by sector. */
+
+/* JOURNAL_LOCK protects all of the variables below, the slots,
+   and the sector buffers.  A commit writes to disk without holding
+   it, with WRITING set: until WRITING goes false, nothing but the
+   committing thread changes the slots, the log, or the sector
+   buffers. */
+static struct lock journal_lock;
+static struct condition journal_changed; /* Operation or commit ended. */
+static bool enabled;                    /* Journal in use? */
+static unsigned active_cnt;             /* Operations in progress. */
+static bool committing;                 /* Commit in progress? */
+static bool writing;                    /* Commit writing to disk? */
+static struct thread *committer;        /* Thread committing. */
+static size_t slot_cnt;                 /* Slots in use. */
+static size_t reserved;                 /* Slots set aside, not yet used. */
+static size_t flush_slots;              /* Slots kept for the free map. */
+static size_t running_cnt;              /* Slots changed since commit. */
+static uint32_t next_seq;               /* Number of next transaction. */
+static size_t log_used;                 /* Log sectors in use. */
+
+/* Sector buffers. */
+static struct journal_header header;
+static struct journal_desc desc;
+static struct journal_commit commit_rec;
+static struct slot *order[SLOT_CNT];
+/* === ADD p4q13 === */
+static const void *buffers[SLOT_CNT + 1];
+
+/* Statistics. */
+static unsigned long long op_cnt;       /* Operations begun. */
+static unsigned long long commit_cnt;   /* Transactions committed. */
+static unsigned long long logged_cnt;   /* Sectors written to the log. */
+static unsigned long long checkpoint_cnt; /* Checkpoints. */
+static unsigned long long replay_cnt;   /* Transactions replayed. */
+
+static unsigned slot_hash (const struct hash_elem *, void *);
+static bool slot_less (const struct hash_elem *, const struct hash_elem *,
+                       void *);
+static bool recover (void);
+static void write_header (void);
+static size_t write_transaction (void);
+static void checkpoint (void);
+static void commit (bool checkpoint_all);
+static void journal_daemon (void *aux);
+
+/* Initializes the journal, which occupies the JOURNAL_SECTORS
+   sectors starting at JOURNAL_SECTOR.  If FORMAT is true, starts
+   an empty journal; otherwise, replays the journal found on the
+   file system device.  A file system created without a journal
+   is used without one. */
+void
+journal_init (bool format)
+{
+  size_t per_page = PGSIZE / BLOCK_SECTOR_SIZE;
+  uint8_t *pages;
+  size_t i;
+
+  ASSERT (sizeof (struct journal_header) == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof (struct journal_desc) == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof (struct journal_commit) == BLOCK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&journal_changed);
+  if (!hash_init (&held, slot_hash, slot_less, NULL))
+    PANIC ("can't allocate journal");
+  pages = palloc_get_multiple (PAL_ASSERT, SLOT_CNT / per_page);
+  for (i = 0; i < SLOT_CNT; i++)
+    {
+      slots[i].in_use = false;
+      slots[i].data = pages + i * BLOCK_SECTOR_SIZE;
+    }
+
+  /* A commit may write every sector of the free map file.  A
+     device whose free map would crowd out everything else is used
+     without a journal. */
+  flush_slots = DIV_ROUND_UP (block_size (fs_device),
+                              BLOCK_SECTOR_SIZE * 8);
+  if (block_size (fs_device) < JOURNAL_SECTOR + JOURNAL_SECTORS
+      || flush_slots > SLOT_CNT / 4)
+    return;
+  if (format)
+    {
+      next_seq = 1;
+      write_header ();
+      enabled = true;
+    }
+  else
+    enabled = recover ();
+  if (enabled)
+    thread_create ("journal", PRI_DEFAULT, journal_daemon, NULL);
+}
+
+/* Commits everything and checkpoints it, leaving the log empty,
+   and writes all other unwritten data to disk. */
+void
+journal_done (void)
+{
+  if (enabled)
+    commit (true);
+  else
+    journal_commit ();
+}
+
+/* Starts an operation that may change up to JOURNAL_OP_SECTORS
+   metadata sectors. */
+void
+journal_begin (void)
+{
+  if (!journal_begin_sectors (JOURNAL_OP_SECTORS))
+    NOT_REACHED ();
+}
+
+/* Starts an operation that may change up to CNT metadata
+   sectors.  Waits if a commit is in progress, or commits first if
+   the running transaction is large or the journal lacks room for
+   CNT more sectors.  Returns false, without starting an
+   operation, if the journal could never hold CNT sectors.  A
+   nested operation shares what the outer one set aside. */
+bool
+journal_begin_sectors (size_t cnt)
+{
+  struct thread *t = thread_current ();
+
+  if (!enabled)
+    return true;
+
+  /* A nested operation is part of the one around it, and the
+     committing thread's own writes are part of its commit. */
+  if (t->journal_depth > 0 || committer == t)
+    {
+      t->journal_depth++;
+      return true;
+    }
+  if (cnt > SLOT_CNT - flush_slots)
+    return false;
+
+  lock_acquire (&journal_lock);
+  for (;;)
+    {
+      bool no_room = slot_cnt + reserved + cnt + flush_slots > SLOT_CNT;
+
+      if (committing)
+        cond_wait (&journal_changed, &journal_lock);
+      else if (no_room || running_cnt >= COMMIT_CNT)
+        {
+          /* A checkpoint empties the journal. */
+          lock_release (&journal_lock);
+          commit (no_room);
+          lock_acquire (&journal_lock);
+        }
+      else
+        break;
+    }
+  active_cnt++;
+  op_cnt++;
+  reserved += cnt;
+  lock_release (&journal_lock);
+  t->journal_depth = 1;
+  t->journal_credits = cnt;
+  return true;
+}
+
+/* Sets aside CNT more slots for the operation in progress, if
+   the journal has room for them now.  Returns true if
+   successful, false if the operation must do without changing
+   those sectors.  Never waits. */
+bool
+journal_extend (size_t cnt)
+{
+  struct thread *t = thread_current ();
+  bool success;
+
+  if (!enabled || committer == t)
+    return true;
+
+  ASSERT (t->journal_depth > 0);
+  lock_acquire (&journal_lock);
+  success = slot_cnt + reserved + cnt + flush_slots <= SLOT_CNT;
+  if (success)
+    {
+      reserved += cnt;
+      t->journal_credits += cnt;
+    }
+  lock_release (&journal_lock);
+  return success;
+}
+
+/* Ends an operation started with journal_begin(). */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+
+  if (!enabled)
+    return;
+
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0 || committer == t)
+    return;
+
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0);
+  reserved -= t->journal_credits;
+  t->journal_credits = 0;
+  if (--active_cnt == 0)
+    cond_broadcast (&journal_changed, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Records DATA, BLOCK_SECTOR_SIZE bytes, as the new contents of
+   SECTOR, if SECTOR is METADATA or already held by the journal.
+   Returns true if the journal now holds SECTOR's newest contents
+   and will write them to disk, false if the caller must.  Data
+   sectors that the journal holds, because they were metadata
+   until lately, stay with it, so that a checkpoint never
+   overwrites them with old contents.  A new metadata sector
+   takes one of the slots that its operation set aside. */
+bool
+journal_write (block_sector_t sector, const void *data, bool metadata)
+{
+  struct slot key;
+  struct slot *s = NULL;
+  struct hash_elem *e;
+
+  if (!enabled)
+    return false;
+
+  lock_acquire (&journal_lock);
+  while (writing)
+    cond_wait (&journal_changed, &journal_lock);
+  key.sector = sector;
+  e = hash_find (&held, &key.elem);
+  if (e != NULL)
+    s = hash_entry (e, struct slot, elem);
+  else if (metadata)
+    {
+      struct thread *t = thread_current ();
+
+      /* Outside an operation, or past what its operation set
+         aside, a sector takes a slot that nobody has set aside.
+         The commit's own writes use the room kept for them. */
+      if (t->journal_credits > 0)
+        {
+          t->journal_credits--;
+          reserved--;
+        }
+      else if (slot_cnt + reserved
+               + (committer == t ? 0 : flush_slots) >= SLOT_CNT)
+        PANIC ("journal full: operation changed too many sectors");
+      for (s = slots; s->in_use; s++)
+        continue;
+      s->sector = sector;
+      s->in_use = true;
+      s->running = false;
+      hash_insert (&held, &s->elem);
+      slot_cnt++;
+    }
+
+  if (s != NULL)
+    {
+      memcpy (s->data, data, BLOCK_SECTOR_SIZE);
+      if (!s->running)
+        {
+          s->running = true;
+          running_cnt++;
+        }
+    }
+  lock_release (&journal_lock);
+  return s != NULL;
+}
+
+/* Reads SECTOR into BUFFER, which must have room for
+   BLOCK_SECTOR_SIZE bytes: the journal's copy if it has one,
+   otherwise the sector on disk. */
+void
+journal_read (block_sector_t sector, void *buffer)
+{
+  if (!enabled)
+    {
+      block_read (fs_device, sector, buffer);
+      return;
+    }
+
+  for (;;)
+    {
+      unsigned long long checkpoints;
+      struct slot key;
+      struct hash_elem *e;
+      bool done;
+
+      lock_acquire (&journal_lock);
+      checkpoints = checkpoint_cnt;
+      lock_release (&journal_lock);
+
+      block_read (fs_device, sector, buffer);
+
+      lock_acquire (&journal_lock);
+      key.sector = sector;
+      e = hash_find (&held, &key.elem);
+      if (e != NULL)
+        memcpy (buffer, hash_entry (e, struct slot, elem)->data,
+                BLOCK_SECTOR_SIZE);
+
+      /* A checkpoint that ran during the read may have written
+         SECTOR and then dropped it from the journal, so the read
+         may have missed both. */
+      done = e != NULL || checkpoints == checkpoint_cnt;
+      lock_release (&journal_lock);
+      if (done)
+        return;
+    }
+}
+
+/* Commits the operations that have ended, writing all file system
+   data that is only in memory to disk or to the log. */
+void
+journal_commit (void)
+{
+  if (enabled)
+    commit (false);
+  else
+    {
+      free_map_flush ();
+      cache_flush ();
+    }
+}
+
+/* Returns true if the file system is journaled. */
+bool
+journal_enabled (void)
+{
+  return enabled;
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  printf ("Journal: %llu operations in %llu commits, %llu sectors logged\n",
+          op_cnt, commit_cnt, logged_cnt);
+  printf ("Journal: %llu checkpoints, %llu replayed\n",
+          checkpoint_cnt, replay_cnt);
+}
+
+/* Returns a hash value for the slot that E is embedded in. */
+static unsigned
+slot_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct slot, elem)->sector);
+}
+
+/* Returns true if the slot that A is embedded in precedes the
+   one that B is embedded in. */
+static bool
+slot_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED)
+{
+  return (hash_entry (a, struct slot, elem)->sector
+          < hash_entry (b, struct slot, elem)->sector);
+}
+
+/* Compares the home sectors of the slots that A and B point to,
+   for qsort(). */
+static int
+compare_slots (const void *a_, const void *b_)
+{
+  const struct slot *a = *(struct slot *const *) a_;
+  const struct slot *b = *(struct slot *const *) b_;
+
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+/* Adds the SIZE bytes in BUF to checksum SUM and returns the
+   result (32-bit FNV-1a). */
+static uint32_t
+checksum (uint32_t sum, const void *buf_, size_t size)
+{
+  const uint8_t *buf = buf_;
+
+  while (size-- > 0)
+    sum = (sum ^ *buf++) * 16777619;
+  return sum;
+}
+
+#define CHECKSUM_INIT 2166136261u
+
+/* Writes the header for a log that starts with transaction
+   NEXT_SEQ, which empties the log. */
+static void
+write_header (void)
+{
+  memset (&header, 0, sizeof header);
+  header.magic = JOURNAL_MAGIC;
+  header.seq = next_seq;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+  log_used = 0;
+}
+
+/* Replays the committed transactions in the log and empties it.
+   Returns false if the file system device has no journal. */
+static bool
+recover (void)
+{
+  uint8_t *buf = slots[0].data;         /* Room for SLOT_CNT sectors. */
+  size_t pos = 0;
+  uint32_t seq;
+
+  block_read (fs_device, JOURNAL_SECTOR, &header);
+  if (header.magic != JOURNAL_MAGIC)
+    return false;
+
+  for (seq = header.seq; pos + 2 <= LOG_SECTORS; seq++)
+    {
+      uint32_t sum = CHECKSUM_INIT;
+      size_t i;
+
+      block_read (fs_device, LOG_START + pos, &desc);
+      /* === MODIFY p4q13 === */
+      if (desc.magic != DESC_MAGIC || desc.seq != seq
+          || desc.cnt > SLOT_CNT || pos + desc.cnt + 2 > LOG_SECTORS)
+        break;
+      block_read (fs_device, LOG_START + pos + desc.cnt + 1, &commit_rec);
+      if (commit_rec.magic != COMMIT_MAGIC || commit_rec.seq != seq
+          || commit_rec.cnt != desc.cnt)
+        break;
+
+      /* A transaction whose sectors did not all reach the log
+         before the system stopped is not replayed, and neither
+         is anything after it. */
+      /* === MODIFY START p4q13 ===*/
+      block_read_multi (fs_device, LOG_START + pos + 1, desc.cnt, buf);
+      sum = checksum (sum, buf, desc.cnt * BLOCK_SECTOR_SIZE);
+      if (sum != commit_rec.checksum)
+        break;
+
+      for (i = 0; i < desc.cnt; i++)
+        block_write (fs_device, desc.sectors[i],
+                     buf + i * BLOCK_SECTOR_SIZE);
+      /* === MODIFY END p4q13 ===*/
+      replay_cnt++;
+      pos += desc.cnt + 2;
+    }
+  if (replay_cnt > 0)
+    printf ("journal: replayed %llu transactions\n", replay_cnt);
+
+  next_seq = seq;
+  write_header ();
+  return true;
+}
+
+/* Writes the sectors changed since the last commit to the log,
+   as transaction NEXT_SEQ, starting LOG_USED sectors into the
+   log.  Returns the number of sectors in the transaction, 0 if
+   nothing has changed.  Called during a commit, with WRITING set
+   and JOURNAL_LOCK released, which leaves the log to the
+   committing thread. */
+static size_t
+write_transaction (void)
+{
+  struct hash_iterator i;
+  block_sector_t pos = LOG_START + log_used;
+  uint32_t sum = CHECKSUM_INIT;
+  size_t cnt = 0;
+  size_t j;
+
+  ASSERT (writing);
+  if (running_cnt == 0)
+    return 0;
+  ASSERT (log_used + running_cnt + 2 <= LOG_SECTORS);
+
+  memset (&desc, 0, sizeof desc);
+  desc.magic = DESC_MAGIC;
+  desc.seq = next_seq;
+  hash_first (&i, &held);
+  while (hash_next (&i))
+    {
+      struct slot *s = hash_entry (hash_cur (&i), struct slot, elem);
+      if (s->running)
+        {
+          desc.sectors[cnt] = s->sector;
+          order[cnt++] = s;
+          sum = checksum (sum, s->data, BLOCK_SECTOR_SIZE);
+          s->running = false;
+        }
+    }
+  desc.cnt = cnt;
+
+  memset (&commit_rec, 0, sizeof commit_rec);
+  commit_rec.magic = COMMIT_MAGIC;
+  commit_rec.seq = next_seq;
+  commit_rec.cnt = cnt;
+  commit_rec.checksum = sum;
+
+  /* The commit record goes last, in a request of its own, so that
+     it reaches the disk only after everything it vouches for. */
+  /* === MODIFY START p4q13 ===*/
+  buffers[0] = &desc;
+  for (j = 0; j < cnt; j++)
+    buffers[1 + j] = order[j]->data;
+  block_writev (fs_device, pos, cnt + 1, buffers);
+  block_write (fs_device, pos + 1 + cnt, &commit_rec);
+  /* === MODIFY END p4q13 ===*/
+
+  log_used += cnt + 2;
+  next_seq++;
+  return cnt;
+}
+
+/* Writes every sector held by the journal to its home, in order
+   of sector number, then empties the log.  Every slot must be
+   committed.  Called during a commit, with WRITING set and
+   JOURNAL_LOCK released; the caller then empties the journal. */
+static void
+checkpoint (void)
+{
+  size_t cnt = 0;
+  size_t i;
+
+  ASSERT (writing);
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].in_use)
+      {
+        ASSERT (!slots[i].running);
+        order[cnt++] = &slots[i];
+      }
+  qsort (order, cnt, sizeof *order, compare_slots);
+  /* === MODIFY START p4q13 ===*/
+  /* Each run of consecutive sectors is one request. */
+  for (i = 0; i < cnt; )
+    {
+      size_t n = 0;
+
+      do
+        {
+          buffers[n] = order[i + n]->data;
+          n++;
+        }
+      while (i + n < cnt
+             && order[i + n]->sector == order[i]->sector + n);
+      block_writev (fs_device, order[i]->sector, n, buffers);
+      i += n;
+    }
+  /* === MODIFY END p4q13 ===*/
+
+  /* Only now that every sector is home may the log be reused. */
+  write_header ();
+}
+
+/* Commits the running transaction, and then checkpoints if
+   CHECKPOINT_ALL is true or if the log or the journal is filling
+   up.  If another thread is already committing, just waits for it
+   to finish, since its commit includes every operation that has
+   ended.  Must not be called from within an operation. */
+static void
+commit (bool checkpoint_all)
+{
+  size_t cnt;
+  bool full;
+  size_t i;
+
+  ASSERT (thread_current ()->journal_depth == 0);
+
+  lock_acquire (&journal_lock);
+  if (committing)
+    {
+      while (committing)
+        cond_wait (&journal_changed, &journal_lock);
+      if (!checkpoint_all)
+        {
+          lock_release (&journal_lock);
+          return;
+        }
+    }
+  committing = true;
+  committer = thread_current ();
+  while (active_cnt > 0)
+    cond_wait (&journal_changed, &journal_lock);
+  lock_release (&journal_lock);
+
+  /* Bring the free map file up to date with the operations being
+     committed, and write file data before the metadata that
+     refers to it. */
+  free_map_flush ();
+  cache_flush ();
+
+  /* Write the log, and the checkpoint if any, without holding
+     JOURNAL_LOCK, so that readers are not held up by the disk. */
+  lock_acquire (&journal_lock);
+  writing = true;
+  lock_release (&journal_lock);
+
+  cnt = write_transaction ();
+  full = (checkpoint_all || log_used + SLOT_CNT + 2 > LOG_SECTORS
+          || slot_cnt > SLOT_CNT / 2);
+  if (full)
+    checkpoint ();
+
+  lock_acquire (&journal_lock);
+  if (cnt > 0)
+    {
+      running_cnt = 0;
+      commit_cnt++;
+      logged_cnt += cnt;
+    }
+  if (full)
+    {
+      hash_clear (&held, NULL);
+      for (i = 0; i < SLOT_CNT; i++)
+        slots[i].in_use = false;
+      slot_cnt = 0;
+      checkpoint_cnt++;
+    }
+  writing = false;
+  committing = false;
+  committer = NULL;
+  cond_broadcast (&journal_changed, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Journal thread.  Commits every COMMIT_INTERVAL ticks, so that
+   the operations of that interval share one log write. */
+static void
+journal_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (COMMIT_INTERVAL);
+      if (running_cnt > 0)
+        commit (false);
+    }
+}
+/* === ADD END p4q12 ===*/
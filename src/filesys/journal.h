@@ -0,0 +1,30 @@
+/* === ADD START p4q12 ===*/
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Sectors reserved for the journal, starting at JOURNAL_SECTOR:
+   a header sector followed by the log. */
+#define JOURNAL_SECTORS 256
+
+/* Metadata sectors that journal_begin() sets aside for one
+   operation. */
+#define JOURNAL_OP_SECTORS 8
+
+void journal_init (bool format);
+void journal_done (void);
+void journal_begin (void);
+bool journal_begin_sectors (size_t cnt);
+bool journal_extend (size_t cnt);
+void journal_end (void);
+bool journal_write (block_sector_t, const void *, bool metadata);
+void journal_read (block_sector_t, void *);
+void journal_commit (void);
+bool journal_enabled (void);
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
+/* === ADD END p4q12 ===*/
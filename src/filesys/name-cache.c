@@ -0,0 +1,131 @@
+/* === ADD START p4q8 ===*/
+#include "filesys/name-cache.h"
+#include <hash.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* Name cache.
+
+   Remembers the results of recent directory lookups, mapping a
+   directory's inode sector and a name in it to the inode sector
+   that the name refers to.  A name that was looked up and not
+   found is remembered too, as a negative entry with sector 0,
+   which can never be a file's inode because it holds the free
+   map.  The cache is direct-mapped: each (directory, name) pair
+   has exactly one slot, and a newer entry simply replaces what
+   was there.
+
+   The directory code keeps the cache exact: dir_add() and
+   dir_remove() record the new state of each name they change,
+   and removing a directory purges all of its entries, so that a
+   later directory in the same sector cannot inherit them. */
+
+/* Number of slots. */
+#define NAME_CACHE_SIZE 256
+
+/* A cached lookup. */
+struct name_entry
+  {
+    bool valid;                         /* Slot in use? */
+    block_sector_t dir;                 /* Directory's inode sector. */
+    block_sector_t sector;              /* Inode sector, or 0 if absent. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+  };
+
+static struct name_entry name_cache[NAME_CACHE_SIZE];
+static struct lock name_cache_lock;
+
+/* Statistics. */
+static unsigned long long hit_cnt;      /* Lookups found in the cache. */
+static unsigned long long negative_cnt; /* ...that said "no such name". */
+static unsigned long long miss_cnt;     /* Lookups not in the cache. */
+
+/* Initializes the name cache. */
+void
+name_cache_init (void)
+{
+  size_t i;
+
+  for (i = 0; i < NAME_CACHE_SIZE; i++)
+    name_cache[i].valid = false;
+  lock_init (&name_cache_lock);
+}
+
+/* Returns the slot for NAME in directory DIR. */
+static struct name_entry *
+slot (block_sector_t dir, const char *name)
+{
+  unsigned hash = hash_string (name) ^ hash_int (dir);
+  return &name_cache[hash % NAME_CACHE_SIZE];
+}
+
+/* Looks up NAME in directory DIR.  If the cache knows the
+   answer, returns true and sets *SECTOR to the inode sector that
+   NAME refers to, or to 0 if DIR has no file NAME.  Returns false
+   if the directory itself must be searched. */
+bool
+name_cache_lookup (block_sector_t dir, const char *name,
+                   block_sector_t *sector)
+{
+  struct name_entry *e = slot (dir, name);
+  bool hit;
+
+  lock_acquire (&name_cache_lock);
+  hit = e->valid && e->dir == dir && !strcmp (e->name, name);
+  if (hit)
+    {
+      *sector = e->sector;
+      hit_cnt++;
+      if (e->sector == 0)
+        negative_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&name_cache_lock);
+  return hit;
+}
+
+/* Records that NAME in directory DIR refers to the inode in
+   SECTOR, or that there is no such file if SECTOR is 0. */
+void
+name_cache_insert (block_sector_t dir, const char *name,
+                   block_sector_t sector)
+{
+  struct name_entry *e = slot (dir, name);
+
+  /* A longer name cannot be stored without truncating it, which
+     would make it match a different name. */
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&name_cache_lock);
+  e->valid = true;
+  e->dir = dir;
+  e->sector = sector;
+  strlcpy (e->name, name, sizeof e->name);
+  lock_release (&name_cache_lock);
+}
+
+/* Forgets every name cached for directory DIR. */
+void
+name_cache_purge_dir (block_sector_t dir)
+{
+  size_t i;
+
+  lock_acquire (&name_cache_lock);
+  for (i = 0; i < NAME_CACHE_SIZE; i++)
+    if (name_cache[i].dir == dir)
+      name_cache[i].valid = false;
+  lock_release (&name_cache_lock);
+}
+
+/* Prints name cache statistics. */
+void
+name_cache_print_stats (void)
+{
+  printf ("Name cache: %llu hits (%llu negative), %llu misses\n",
+          hit_cnt, negative_cnt, miss_cnt);
+}
+/* === ADD END p4q8 ===*/
@@ -0,0 +1,17 @@
+/* === ADD START p4q8 ===*/
+#ifndef FILESYS_NAME_CACHE_H
+#define FILESYS_NAME_CACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+void name_cache_init (void);
+bool name_cache_lookup (block_sector_t dir, const char *name,
+                        block_sector_t *sector);
+void name_cache_insert (block_sector_t dir, const char *name,
+                        block_sector_t sector);
+void name_cache_purge_dir (block_sector_t dir);
+void name_cache_print_stats (void);
+
+#endif /* filesys/name-cache.h */
+/* === ADD END p4q8 ===*/
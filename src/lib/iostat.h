@@ -0,0 +1,29 @@
+#ifndef __LIB_IOSTAT_H
+#define __LIB_IOSTAT_H
+
+/* Per-device block I/O statistics, as returned by the iostat()
+   system call. */
+
+/* Number of buckets in a latency histogram.  Bucket I counts the
+   requests that took at least 2**I microseconds but less than
+   2**(I+1), except that bucket 0 also counts those under 1 us
+   and the last bucket everything longer. */
+#define IOSTAT_HIST_CNT 24
+
+/* Statistics for one block device. */
+struct iostat
+  {
+    char name[16];                      /* Device name, e.g. "hda1". */
+    char role[16];                      /* Type, e.g. "filesys". */
+    unsigned long long read_reqs;       /* Read requests completed. */
+    unsigned long long write_reqs;      /* Write requests completed. */
+    unsigned long long read_bytes;      /* Bytes read. */
+    unsigned long long write_bytes;     /* Bytes written. */
+    unsigned long long queue_us;        /* Total us waiting in queue. */
+    unsigned long long service_us;      /* Total us being transferred. */
+    unsigned depth;                     /* Requests now outstanding. */
+    unsigned peak_depth;                /* Most ever outstanding. */
+    unsigned long long hist[IOSTAT_HIST_CNT];   /* Latency histogram. */
+  };
+
+#endif /* lib/iostat.h */
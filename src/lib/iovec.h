@@ -0,0 +1,17 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* One segment of a vectored read or write: IOV_LEN bytes at
+   IOV_BASE. */
+struct iovec
+  {
+    void *iov_base;             /* Start of segment. */
+    size_t iov_len;             /* Length of segment in bytes. */
+  };
+
+/* Most segments in one readv() or writev() call. */
+#define IOV_MAX 64
+
+#endif /* lib/iovec.h */
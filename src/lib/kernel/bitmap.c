@@ -358,6 +358,27 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* === ADD START p4q9 ===*/
+/* Writes the part of B's file that holds the CNT bits starting
+   at START to FILE, leaving the rest of FILE alone.
+   Returns true if successful, false otherwise. */
+bool
+bitmap_write_part (const struct bitmap *b, struct file *file,
+                   size_t start, size_t cnt)
+{
+  off_t first, last;
+
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (start + cnt <= b->bit_cnt);
+
+  first = start / CHAR_BIT;
+  last = DIV_ROUND_UP (start + cnt, CHAR_BIT);
+  return (file_write_at (file, (uint8_t *) b->bits + first, last - first,
+                         first)
+          == last - first);
+}
+/* === ADD END p4q9 ===*/
 #endif /* FILESYS */
 
 /* Debugging. */
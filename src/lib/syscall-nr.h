@@ -28,7 +28,16 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SYNC,                   /* Write cached file data to disk. */
+    SYS_IOSTAT,                 /* Obtain block device statistics. */
+    SYS_COPY_FILE_RANGE,        /* Copy data between two files. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+    SYS_READV,                  /* Read from a file into segments. */
+    SYS_WRITEV                  /* Write to a file from segments. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <iostat.h>
+#include <iovec.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,13 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+void sync (void);
+int iostat (struct iostat *, int cnt);
+int copy_file_range (int fd_in, int fd_out, unsigned size);
+int pread (int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned size, unsigned offset);
+int readv (int fd, const struct iovec *, int iov_cnt);
+int writev (int fd, const struct iovec *, int iov_cnt);
+
 #endif /* lib/user/syscall.h */
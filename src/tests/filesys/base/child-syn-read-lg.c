@@ -0,0 +1,47 @@
+/* Child process for syn-read-lg test.
+   Reads the whole test file a sector at a time, starting at a
+   different chunk in each child and wrapping around, so that
+   the children keep reading different parts of the file at the
+   same time. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/syn-read-lg.h"
+
+static char buf[BUF_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  char chunk[CHUNK_SIZE];
+  size_t chunk_cnt = BUF_SIZE / CHUNK_SIZE;
+  int child_idx;
+  int fd;
+  size_t i;
+
+  test_name = "child-syn-read-lg";
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (i = 0; i < chunk_cnt; i++) 
+    {
+      size_t ofs = (child_idx + i) % chunk_cnt * CHUNK_SIZE;
+
+      seek (fd, ofs);
+      CHECK (read (fd, chunk, CHUNK_SIZE) == CHUNK_SIZE,
+             "read \"%s\"", file_name);
+      compare_bytes (chunk, buf + ofs, CHUNK_SIZE, ofs, file_name);
+    }
+  close (fd);
+
+  return child_idx;
+}
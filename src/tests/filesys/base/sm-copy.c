@@ -0,0 +1,50 @@
+/* Copies a file of a few sectors, whose length is not a multiple
+   of the sector size, with copy_file_range, and verifies that the
+   copy matches.  Also checks that copying a file onto an
+   overlapping range of itself is refused. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[1234];
+
+void
+test_main (void) 
+{
+  const char *src_name = "pinto";
+  const char *dst_name = "bean";
+  int src_fd, dst_fd, fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (src_name, 0), "create \"%s\"", src_name);
+  CHECK ((src_fd = open (src_name)) > 1, "open \"%s\"", src_name);
+  CHECK (write (src_fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", src_name);
+  CHECK (create (dst_name, 0), "create \"%s\"", dst_name);
+  CHECK ((dst_fd = open (dst_name)) > 1, "open \"%s\"", dst_name);
+
+  seek (src_fd, 0);
+  CHECK (copy_file_range (src_fd, dst_fd, sizeof buf + 100) == sizeof buf,
+         "copy \"%s\" to \"%s\"", src_name, dst_name);
+  CHECK (tell (src_fd) == sizeof buf && tell (dst_fd) == sizeof buf,
+         "both positions advanced");
+
+  CHECK (copy_file_range (src_fd, src_fd, 10) == -1,
+         "copy \"%s\" onto itself", src_name);
+  CHECK ((fd = open (src_name)) > 1, "open \"%s\" again", src_name);
+  seek (src_fd, 100);
+  seek (fd, 0);
+  CHECK (copy_file_range (src_fd, fd, 200) == -1,
+         "copy \"%s\" onto an overlapping range", src_name);
+  close (fd);
+
+  msg ("close \"%s\"", src_name);
+  close (src_fd);
+  msg ("close \"%s\"", dst_name);
+  close (dst_fd);
+
+  check_file (dst_name, buf, sizeof buf);
+  check_file (src_name, buf, sizeof buf);
+}
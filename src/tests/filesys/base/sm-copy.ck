@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sm-copy) begin
+(sm-copy) create "pinto"
+(sm-copy) open "pinto"
+(sm-copy) write "pinto"
+(sm-copy) create "bean"
+(sm-copy) open "bean"
+(sm-copy) copy "pinto" to "bean"
+(sm-copy) both positions advanced
+(sm-copy) copy "pinto" onto itself
+(sm-copy) open "pinto" again
+(sm-copy) copy "pinto" onto an overlapping range
+(sm-copy) close "pinto"
+(sm-copy) close "bean"
+(sm-copy) open "bean" for verification
+(sm-copy) verified contents of "bean"
+(sm-copy) close "bean"
+(sm-copy) open "pinto" for verification
+(sm-copy) verified contents of "pinto"
+(sm-copy) close "pinto"
+(sm-copy) end
+EOF
+pass;
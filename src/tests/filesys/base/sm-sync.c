@@ -0,0 +1,27 @@
+/* Writes a small file, forces it to disk with sync, and then
+   reads it back to verify that it was written properly. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2345];
+
+void
+test_main (void) 
+{
+  const char *file_name = "sinker";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  msg ("sync");
+  sync ();
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sm-sync) begin
+(sm-sync) create "sinker"
+(sm-sync) open "sinker"
+(sm-sync) write "sinker"
+(sm-sync) sync
+(sm-sync) close "sinker"
+(sm-sync) open "sinker" for verification
+(sm-sync) verified contents of "sinker"
+(sm-sync) close "sinker"
+(sm-sync) end
+EOF
+pass;
@@ -0,0 +1,55 @@
+/* Writes a small file with writev, in unevenly sized segments,
+   then reads it back with readv, split differently, asking for
+   more than the file holds, to verify that the read stops short
+   at end of file. */
+
+#include <iovec.h>
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE 1234
+
+static char buf[TEST_SIZE];
+static char rbuf[TEST_SIZE + 100];
+
+void
+test_main (void) 
+{
+  const char *file_name = "vector";
+  struct iovec iov[3];
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = buf + 1;
+  iov[1].iov_len = 600;
+  iov[2].iov_base = buf + 601;
+  iov[2].iov_len = TEST_SIZE - 601;
+  CHECK (writev (fd, iov, 3) == TEST_SIZE,
+         "writev \"%s\" in 3 segments", file_name);
+  CHECK (writev (fd, iov, IOV_MAX + 1) == -1,
+         "writev %d segments fails", IOV_MAX + 1);
+
+  seek (fd, 0);
+  iov[0].iov_base = rbuf;
+  iov[0].iov_len = 513;
+  iov[1].iov_base = rbuf + 513;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = rbuf + 513;
+  iov[2].iov_len = sizeof rbuf - 513;
+  CHECK (readv (fd, iov, 3) == TEST_SIZE,
+         "readv \"%s\" past end of file", file_name);
+  compare_bytes (rbuf, buf, TEST_SIZE, 0, file_name);
+  CHECK (readv (fd, iov, 3) == 0, "readv \"%s\" at end of file", file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  check_file (file_name, buf, sizeof buf);
+}
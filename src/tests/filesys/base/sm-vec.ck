@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sm-vec) begin
+(sm-vec) create "vector"
+(sm-vec) open "vector"
+(sm-vec) writev "vector" in 3 segments
+(sm-vec) writev 65 segments fails
+(sm-vec) readv "vector" past end of file
+(sm-vec) readv "vector" at end of file
+(sm-vec) close "vector"
+(sm-vec) open "vector" for verification
+(sm-vec) verified contents of "vector"
+(sm-vec) close "vector"
+(sm-vec) end
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Spawns 10 child processes, all of which read a large file at
+   the same time, a sector at a time, and make sure that the
+   contents are what they should be.  Readers share the file's
+   lock, so they should not have to wait for one another. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/syn-read-lg.h"
+
+static char buf[BUF_SIZE];
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int fd;
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  exec_children ("child-syn-read-lg", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+}
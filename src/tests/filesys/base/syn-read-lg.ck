@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-read-lg) begin
+(syn-read-lg) create "bigdata"
+(syn-read-lg) open "bigdata"
+(syn-read-lg) write "bigdata"
+(syn-read-lg) close "bigdata"
+(syn-read-lg) exec child 1 of 10: "child-syn-read-lg 0"
+(syn-read-lg) exec child 2 of 10: "child-syn-read-lg 1"
+(syn-read-lg) exec child 3 of 10: "child-syn-read-lg 2"
+(syn-read-lg) exec child 4 of 10: "child-syn-read-lg 3"
+(syn-read-lg) exec child 5 of 10: "child-syn-read-lg 4"
+(syn-read-lg) exec child 6 of 10: "child-syn-read-lg 5"
+(syn-read-lg) exec child 7 of 10: "child-syn-read-lg 6"
+(syn-read-lg) exec child 8 of 10: "child-syn-read-lg 7"
+(syn-read-lg) exec child 9 of 10: "child-syn-read-lg 8"
+(syn-read-lg) exec child 10 of 10: "child-syn-read-lg 9"
+(syn-read-lg) wait for child 1 of 10 returned 0 (expected 0)
+(syn-read-lg) wait for child 2 of 10 returned 1 (expected 1)
+(syn-read-lg) wait for child 3 of 10 returned 2 (expected 2)
+(syn-read-lg) wait for child 4 of 10 returned 3 (expected 3)
+(syn-read-lg) wait for child 5 of 10 returned 4 (expected 4)
+(syn-read-lg) wait for child 6 of 10 returned 5 (expected 5)
+(syn-read-lg) wait for child 7 of 10 returned 6 (expected 6)
+(syn-read-lg) wait for child 8 of 10 returned 7 (expected 7)
+(syn-read-lg) wait for child 9 of 10 returned 8 (expected 8)
+(syn-read-lg) wait for child 10 of 10 returned 9 (expected 9)
+(syn-read-lg) end
+EOF
+pass;
@@ -0,0 +1,19 @@
+/* Passes writev an iovec array that lies in kernel memory.
+   The process must be terminated with -1 exit code. */
+
+#include <iovec.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+
+  CHECK (create ("quux", 0), "create \"quux\"");
+  CHECK ((handle = open ("quux")) > 1, "open \"quux\"");
+
+  writev (handle, (struct iovec *) 0xc0100000, 2);
+  fail ("should not have survived writev()");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(vec-bad-iov) begin
+(vec-bad-iov) create "quux"
+(vec-bad-iov) open "quux"
+(vec-bad-iov) end
+vec-bad-iov: exit(0)
+EOF
+(vec-bad-iov) begin
+(vec-bad-iov) create "quux"
+(vec-bad-iov) open "quux"
+vec-bad-iov: exit(-1)
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Passes readv an iovec whose second segment points into kernel
+   memory.  The process must be terminated with -1 exit code. */
+
+#include <iovec.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[2];
+  char c;
+  int handle;
+
+  CHECK (create ("quux", 10), "create \"quux\"");
+  CHECK ((handle = open ("quux")) > 1, "open \"quux\"");
+
+  iov[0].iov_base = &c;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = (char *) 0xc0100000;
+  iov[1].iov_len = 123;
+  readv (handle, iov, 2);
+  fail ("should not have survived readv()");
+}
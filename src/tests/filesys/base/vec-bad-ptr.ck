@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(vec-bad-ptr) begin
+(vec-bad-ptr) create "quux"
+(vec-bad-ptr) open "quux"
+(vec-bad-ptr) end
+vec-bad-ptr: exit(0)
+EOF
+(vec-bad-ptr) begin
+(vec-bad-ptr) create "quux"
+(vec-bad-ptr) open "quux"
+vec-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Writes a file and forces it to disk with sync.  The
+   persistence check then reads it back after a reboot. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2345];
+
+void
+test_main (void) 
+{
+  const char *file_name = "sinker";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  msg ("sync");
+  sync ();
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sync-file) begin
+(sync-file) create "sinker"
+(sync-file) open "sinker"
+(sync-file) write "sinker"
+(sync-file) sync
+(sync-file) close "sinker"
+(sync-file) end
+EOF
+pass;
@@ -34,8 +34,17 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+/* === ADD p4q15 === */
+#include "devices/iosched.h"
+/* === ADD p4q17 === */
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+/* === ADD START p4q3 ===*/
+#include "filesys/cache.h"
+/* === ADD END p4q3 ===*/
+/* === ADD p4q5 === */
+#include "filesys/inode.h"
 #endif
 
 /* === ADD START p3q4 ===*/
@@ -43,6 +52,11 @@
 #include "vm/swap.h"
 #endif
 /* === ADD END p3q4 ===*/
+/* === ADD START p4q23 ===*/
+#ifdef VM
+#include "vm/frame.h"
+#endif
+/* === ADD END p4q23 ===*/
 
 
 /* Page directory with kernel mappings only. */
@@ -59,6 +73,12 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+/* === ADD START p4q17 ===*/
+
+/* -ramdisk: Size in kB of a RAM disk to create for each role, or
+   0 if none. */
+static unsigned ramdisk_kb[BLOCK_ROLE_CNT];
+/* === ADD END p4q17 ===*/
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
@@ -75,6 +95,10 @@ static void usage (void);
 #ifdef FILESYS
 static void locate_block_devices (void);
 static void locate_block_device (enum block_type, const char *name);
+/* === ADD START p4q17 ===*/
+static void parse_ramdisk (const char *value);
+static void create_ramdisks (void);
+/* === ADD END p4q17 ===*/
 #endif
 
 int main (void) NO_RETURN;
@@ -130,6 +154,8 @@ main (void)
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+  /* === ADD p4q17 === */
+  create_ramdisks ();
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -138,6 +164,8 @@ main (void)
 #ifdef VM
   locate_block_devices ();
   swap_table_init();
+  /* === ADD p4q25 === */
+  frame_writer_init();
 #endif
 /* === ADD END p3q4 ===*/
 
@@ -258,11 +286,42 @@ parse_options (char **argv)
         shutdown_configure (SHUTDOWN_REBOOT);
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
-        format_filesys = true;
+        {
+          format_filesys = true;
+          /* === ADD START p4q5 ===*/
+          if (value != NULL && !inode_set_format (value))
+            PANIC ("unknown file system format `%s'", value);
+          /* === ADD END p4q5 ===*/
+        }
       else if (!strcmp (name, "-filesys"))
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      /* === ADD START p4q3 ===*/
+      else if (!strcmp (name, "-dirty"))
+        {
+          int cnt = value != NULL ? atoi (value) : 0;
+          if (cnt < 1 || cnt > CACHE_SIZE)
+            PANIC ("-dirty=COUNT requires a COUNT from 1 to %d",
+                   CACHE_SIZE);
+          cache_dirty_high = cnt;
+        }
+      /* === ADD END p4q3 ===*/
+      /* === ADD START p4q14 ===*/
+      else if (!strcmp (name, "-dma"))
+        ide_use_dma = true;
+      /* === ADD END p4q14 ===*/
+      /* === ADD START p4q15 ===*/
+      else if (!strcmp (name, "-iosched"))
+        {
+          if (value == NULL || !iosched_select (value))
+            PANIC ("unknown I/O scheduler `%s'", value);
+        }
+      /* === ADD END p4q15 ===*/
+      /* === ADD START p4q17 ===*/
+      else if (!strcmp (name, "-ramdisk"))
+        parse_ramdisk (value);
+      /* === ADD END p4q17 ===*/
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -272,6 +331,15 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      /* === ADD START p4q23 ===*/
+#ifdef VM
+      else if (!strcmp (name, "-vmpolicy"))
+        {
+          if (value == NULL || !frame_policy_select (value))
+            PANIC ("unknown page replacement policy `%s'", value);
+        }
+#endif
+      /* === ADD END p4q23 ===*/
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -308,6 +376,17 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+/* === ADD START p4q16 ===*/
+#ifdef FILESYS
+/* Prints the block devices' request statistics. */
+static void
+run_iostat (char **argv UNUSED)
+{
+  block_print_iostat ();
+}
+#endif
+/* === ADD END p4q16 ===*/
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -331,6 +410,8 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      /* === ADD p4q16 === */
+      {"iostat", 1, run_iostat},
 #endif
       {NULL, 0, NULL},
     };
@@ -380,6 +461,7 @@ usage (void)
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
+          "  iostat             Print block device request statistics.\n"
 #endif
           "\nOptions:\n"
           "  -h                 Print this help message and power off.\n"
@@ -387,14 +469,26 @@ usage (void)
           "  -r                 Reboot after actions.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
+          "  -f=FORMAT          Format using FORMAT inodes: indexed (default),\n"
+          "                     extent, or contiguous.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -dirty=COUNT       Write back cache once COUNT sectors are dirty.\n"
+          "  -dma               Transfer disk data with DMA if possible.\n"
+          "  -iosched=POLICY    Order disk requests by POLICY: deadline\n"
+          "                     (default), clook, or fifo.\n"
+          "  -ramdisk=ROLE:KB   Use a KB kB RAM disk for ROLE, one of filesys\n"
+          "                     (use with -f), scratch, or swap.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+#ifdef VM
+          "  -vmpolicy=POLICY   Replace pages by POLICY: clock (default),\n"
+          "                     eclock, wsclock, or clockpro.\n"
+#endif
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -442,4 +536,56 @@ locate_block_device (enum block_type role, const char *name)
       block_set_role (role, block);
     }
 }
+
+/* === ADD START p4q17 ===*/
+/* Parses VALUE, the argument of the -ramdisk option, which has
+   the form ROLE:KB, and records that a RAM disk of KB kB should
+   be created for ROLE. */
+static void
+parse_ramdisk (const char *value)
+{
+  const char *colon = value != NULL ? strchr (value, ':') : NULL;
+  int kb;
+  int role;
+
+  if (colon == NULL || (kb = atoi (colon + 1)) <= 0)
+    PANIC ("-ramdisk requires ROLE:KB (use -h for help)");
+  for (role = 0; role < BLOCK_ROLE_CNT; role++)
+    if (role != BLOCK_KERNEL
+        && strlen (block_type_name (role)) == (size_t) (colon - value)
+        && !memcmp (value, block_type_name (role), colon - value))
+      {
+        ramdisk_kb[role] = kb;
+        return;
+      }
+  PANIC ("unknown RAM disk role in `%s'", value);
+}
+
+/* Creates the RAM disks requested with -ramdisk and has each of
+   them used for its role, unless another device was named for
+   the role explicitly. */
+static void
+create_ramdisks (void)
+{
+  int role;
+
+  for (role = 0; role < BLOCK_ROLE_CNT; role++)
+    if (ramdisk_kb[role] != 0)
+      {
+        struct block *block;
+        const char **name;
+
+        block = ramdisk_create (role, ramdisk_kb[role] * 1024
+                                      / BLOCK_SECTOR_SIZE);
+        name = (role == BLOCK_FILESYS ? &filesys_bdev_name
+                : role == BLOCK_SCRATCH ? &scratch_bdev_name
+#ifdef VM
+                : role == BLOCK_SWAP ? &swap_bdev_name
+#endif
+                : NULL);
+        if (name != NULL && *name == NULL)
+          *name = block_name (block);
+      }
+}
+/* === ADD END p4q17 ===*/
 #endif
@@ -65,6 +65,12 @@ palloc_init (size_t user_page_limit)
   init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
   init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
              user_pages, "user pool");
+
+  /* === ADD START p4q21 ===*/
+  /* The frame table has one entry per user pool page, allocated
+     from the kernel pool. */
+  frame_table_init (user_pool.base, bitmap_size (user_pool.used_map));
+  /* === ADD END p4q21 ===*/
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -107,35 +113,39 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
       //        omit panic.
       bool evict_success = true;
       if ( flags & PAL_USER && page_cnt == 1) {
-        struct frame* victim = get_current_victim();
-        evict_success = evict_page( victim ); // call evict
-        if( evict_success ) {
-          palloc_free_page( victim->kaddr ); // free and remove from frame
+        /* === MODIFY START p4q22 ===*/
+        // NOTE : the victim is chosen under the frame lock, but
+        //        written out without it.  Its page stays allocated
+        //        in the bitmap and is handed straight to us, so a
+        //        concurrent allocation cannot steal it.
+        /* === MODIFY START p4q25 ===*/
+        // NOTE : no victim means the swap writer has freed frames
+        //        to the pool meanwhile, so try the pool again.
+        while ( pages == NULL ) {
+          struct frame* victim = frame_choose_victim();
+          if ( victim != NULL ) {
+            evict_success = evict_page( victim ); // call evict
+            pages = victim->kaddr;
+            remove_frame( victim );
+            break;
+          }
+
+          lock_acquire (&pool->lock);
+          page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+          lock_release (&pool->lock);
+
+          if (page_idx != BITMAP_ERROR)
+            pages = pool->base + PGSIZE * page_idx;
         }
+        /* === MODIFY END p4q25 ===*/
 
-        // NOTE : here, PAGES is null, thus we replace pages by
-        //        executing the same context
-        // ===================================================== //
-        lock_acquire (&pool->lock);
-        page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-        lock_release (&pool->lock);
-
-        if (page_idx != BITMAP_ERROR)
-          pages = pool->base + PGSIZE * page_idx;
-        else
-          pages = NULL;
-
-        if (pages != NULL)
-        {
-          if (flags & PAL_ZERO)
-            memset (pages, 0, PGSIZE * page_cnt);
-        }
-        // ===================================================== //
-        if( pages == NULL ){ evict_success = false; }
-        set_next_victim();
+        if (flags & PAL_ZERO)
+          memset (pages, 0, PGSIZE * page_cnt);
+        /* === MODIFY END p4q22 ===*/
       }
 
-      if ( flags & PAL_ASSERT || !evict_success ){
+      /* === MODIFY p4q22 === */
+      if ( ( pages == NULL && flags & PAL_ASSERT ) || !evict_success ){
         PANIC ("palloc_get: out of pages");
       }
       /* === ADD END p3q4 ===*/
@@ -147,10 +157,10 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
     }
 
   /* === ADD START p3q4 ===*/
-  // NOTE : at this point, malloc is available since
-  //        malloc_init is executed in this function
-  //        is guaranteed to execute after that.
-  if ( flags & PAL_USER && page_cnt == 1 ) {
+  // === MODIFY p4q21 === //
+  // NOTE : the frame of each user pool page is preallocated, so
+  //        no malloc happens here.
+  if ( flags & PAL_USER && page_cnt == 1 && pages != NULL ) {
     struct frame* frame = create_frame( pages, thread_current() );
     insert_frame( frame );
   }
@@ -203,9 +213,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   if ( page_from_pool (&user_pool, pages) && page_cnt == 1) {
     struct frame* cur_frame = find_frame( pages );
     ASSERT( cur_frame != NULL );
-    if( is_victim(cur_frame) ) {
-      replace_victim( cur_frame );
-    }
+    /* === DEL START p4q22 ===*/
+//    if( is_victim(cur_frame) ) {
+//      replace_victim( cur_frame );
+//    }
+    /* === DEL END p4q22 ===*/
     remove_frame( cur_frame );
   }
   /* === ADD END p3q4 ===*/
@@ -477,3 +477,70 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* === ADD START p4q11 ===*/
+/* Initializes RW as a readers-writer lock.  Any number of
+   threads may hold RW for reading at once, or a single thread
+   may hold it for writing.
+
+   A reader never waits for a writer that is only waiting, so a
+   thread that holds RW for reading may safely acquire it for
+   reading again (for example, from a page fault taken while
+   copying data to a user buffer).  The price is that a steady
+   stream of readers can hold off a writer. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->changed);
+  rw->readers = 0;
+  rw->writer = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  lock_acquire (&rw->lock);
+  while (rw->writer)
+    cond_wait (&rw->changed, &rw->lock);
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0)
+    cond_broadcast (&rw->changed, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no thread holds it.
+   RW must not already be held by the current thread. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  lock_acquire (&rw->lock);
+  while (rw->writer || rw->readers > 0)
+    cond_wait (&rw->changed, &rw->lock);
+  rw->writer = true;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer);
+  rw->writer = false;
+  cond_broadcast (&rw->changed, &rw->lock);
+  lock_release (&rw->lock);
+}
+/* === ADD END p4q11 ===*/
@@ -41,6 +41,23 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* === ADD START p4q11 ===*/
+/* Readers-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition changed;   /* Signaled when the lock is freed. */
+    unsigned readers;           /* Number of threads reading. */
+    bool writer;                /* True if a thread is writing. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+/* === ADD END p4q11 ===*/
+
 /* === ADD START jinho q2 ===*/
 bool compareSemaPriority(struct list_elem* e1, struct list_elem* e2, void* aux);
 /* === ADD END jinho q2 ===*/
@@ -123,7 +123,10 @@ static bool is_thread (struct thread *) UNUSED;
   /* === ADD END jinho q1 ===*/
 
   /* === ADD START p3q4 ===*/
-  frame_table_init();
+  /* === DEL START p4q21 ===*/
+  // NOTE : the frame table is now initialized by palloc_init().
+  //frame_table_init();
+  /* === DEL END p4q21 ===*/
   /* === ADD END p3q4 ===*/
 
   /* Set up a thread structure for the running thread. */
@@ -168,6 +168,11 @@ struct thread
     struct list mmap_list;
     /* === ADD END p3q3 ===*/
 
+    /* === ADD START p4q12 ===*/
+    int journal_depth;                /* Nesting of journal_begin() calls. */
+    size_t journal_credits;           /* Journal slots set aside, unused. */
+    /* === ADD END p4q12 ===*/
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
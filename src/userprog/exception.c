@@ -17,6 +17,8 @@
 #include "vm/mmap.h"
 #include "vm/swap.h"
 /* === ADD END p3q3 ===*/
+/* === ADD p4q22 === */
+#include "vm/frame.h"
 
 
 /* Number of page faults processed. */
@@ -233,6 +235,15 @@ static bool handle_page_fault(struct pme* fault_pme, void* fault_addr, struct in
   /* === ADD END p3q2 ===*/
 
   ASSERT( fault_pme != NULL );
+  /* === ADD START p4q22 ===*/
+  // NOTE : if the page is being evicted, its pte is already
+  //        cleared; wait until the eviction is done, then load it
+  //        back.  if it turns out to be loaded, just retry.
+  if( frame_pin_pme( fault_pme ) ) {
+    frame_unpin_pme( fault_pme );
+    return true;
+  }
+  /* === ADD END p4q22 ===*/
   uint8_t *kpage = palloc_get_page (PAL_USER);
   if( kpage == NULL ) { return false; }
   // NOTE : from now on, do not forcibly return,
@@ -252,7 +263,8 @@ static bool handle_page_fault(struct pme* fault_pme, void* fault_addr, struct in
         success = false; break;
       }
       // load success
-      fault_pme-> load_status = true;
+      // === MODIFY p4q22 === //
+      frame_install_pme( kpage, fault_pme );
       break;
     // ========================================================= //
     case PME_MMAP:
@@ -265,7 +277,8 @@ static bool handle_page_fault(struct pme* fault_pme, void* fault_addr, struct in
         success = false; break;
       }
       // load success
-      fault_pme-> load_status = true;
+      // === MODIFY p4q22 === //
+      frame_install_pme( kpage, fault_pme );
       break;
     // ========================================================= //
     case PME_SWAP:
@@ -275,7 +288,8 @@ static bool handle_page_fault(struct pme* fault_pme, void* fault_addr, struct in
         success = false; break;
       }
       // load success
-      fault_pme-> load_status = true;
+      // === MODIFY p4q22 === //
+      frame_install_pme( kpage, fault_pme );
       break;
     // ========================================================= //
     default: success = false;
@@ -308,11 +322,14 @@ static int grow_stack(void *fault_addr)
 
   struct pme* pme_to_alloc = create_pme();
   pme_to_alloc->vaddr = upage;
-  pme_to_alloc->load_status = true;
+  /* === MODIFY p4q22 === */
+  pme_to_alloc->load_status = false;
   pme_to_alloc->write_permission = true;
   pme_to_alloc->type = PME_NULL;
 
   pmap_set_pme( &(thread_current()->pmap), pme_to_alloc );
+  /* === ADD p4q22 === */
+  frame_install_pme( kpage, pme_to_alloc );
 
   return true;
 }
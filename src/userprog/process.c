@@ -405,11 +405,6 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* === ADD START jihun p2q3 ===*/
-// NOTE : from syscall.h, for preventing file modification while opened
-extern struct lock fs_lock;
-/* === ADD END jihun p2q3 ===*/
-
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
@@ -424,11 +419,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
   bool success = false;
   int i;
 
-  /* === ADD START jihun p2q3 ===*/
-  // NOTE : must be atomic
-  lock_acquire(&fs_lock);
-  /* === ADD END jihun p2q3 ===*/
-
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL)
@@ -439,9 +429,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
   file = filesys_open (file_name);
   if (file == NULL)
   {
-    /* === ADD START jihun p2q3 ===*/
-    lock_release(&fs_lock);
-    /* === ADD END jihun p2q3 ===*/
     printf ("load: %s: open failed\n", file_name);
     goto done;
   }
@@ -450,7 +437,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
   // NOTE : check current file and deny modification
   t->current_file = file;
   file_deny_write(file);
-  lock_release(&fs_lock);
   /* === ADD END jihun p2q3 ===*/
 
   /* Read and verify executable header. */
@@ -693,13 +679,19 @@ setup_stack (void **esp)
     void* stack_addr = ((uint8_t *) PHYS_BASE) - PGSIZE;
     ASSERT( pg_ofs(stack_addr) == 0 );
     pme_to_alloc->vaddr = stack_addr;
-    pme_to_alloc->load_status = true;
+    /* === MODIFY p4q22 === */
+    pme_to_alloc->load_status = false;
     pme_to_alloc->write_permission = true;
     pme_to_alloc->type = PME_NULL;
 
     if( pmap_set_pme( &(thread_current()->pmap), pme_to_alloc ) == false ){
       success = false;
     }
+    /* === ADD START p4q22 ===*/
+    else {
+      frame_install_pme( kpage, pme_to_alloc );
+    }
+    /* === ADD END p4q22 ===*/
   }
   /* === ADD END p3q1 ===*/
 
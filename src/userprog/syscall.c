@@ -23,6 +23,24 @@
 #include "vm/mmap.h"
 /* === ADD END p3q3 ===*/
 
+/* === ADD START p4q16 ===*/
+#include <iostat.h>
+#include "devices/block.h"
+/* === ADD END p4q16 ===*/
+
+/* === ADD START p4q20 ===*/
+#include <iovec.h>
+/* === ADD END p4q20 ===*/
+
+/* === ADD START p4q22 ===*/
+#include "vm/frame.h"
+
+// NOTE : most pages of a user buffer that one syscall pins at once.
+//        a larger transfer is done in chunks of this many pages, so
+//        that pinned buffers never leave the pager without a victim.
+#define PIN_CHUNK_PAGES 8
+/* === ADD END p4q22 ===*/
+
 
 
 static void syscall_handler (struct intr_frame *);
@@ -49,6 +67,23 @@ void close(int);
 mapid_t mmap(int, void *);
 void munmap(mapid_t);
 /* === ADD END p3q1 ===*/
+/* === ADD START p4q3 ===*/
+void sync(void);
+/* === ADD END p4q3 ===*/
+/* === ADD START p4q16 ===*/
+int iostat(struct iostat *, int);
+/* === ADD END p4q16 ===*/
+/* === ADD START p4q18 ===*/
+int copy_file_range(int, int, unsigned);
+/* === ADD END p4q18 ===*/
+/* === ADD START p4q19 ===*/
+int pread(int, void *, unsigned, unsigned);
+int pwrite(int, const void *, unsigned, unsigned);
+/* === ADD END p4q19 ===*/
+/* === ADD START p4q20 ===*/
+int readv(int, const struct iovec *, int);
+int writev(int, const struct iovec *, int);
+/* === ADD END p4q20 ===*/
 
 // NOTE : helper functions (locally used)
 static bool isValidUserPointer(const void *, bool);
@@ -56,6 +91,20 @@ static void handleInvalidUserPointer(const void *, unsigned);
 static void handleInvalidUserPointerWithWriteable(const void *, unsigned);
 static void _handleInvalidUserPointer(const void *, unsigned, bool);
 static struct file* getFilePointer(int);
+/* === ADD p4q16 === */
+static int countBlockDevices(void);
+/* === ADD START p4q20 ===*/
+static bool copyInIovec(struct iovec *, const struct iovec *, int, bool);
+/* === ADD START p4q22 ===*/
+static void pinUserBuffer(const void *, unsigned);
+static void unpinUserBuffer(const void *, unsigned);
+static void pinIovec(const struct iovec *, int);
+static void unpinIovec(const struct iovec *, int);
+static unsigned pinChunkSize(const void *, unsigned, unsigned);
+static int transferUserBuffer(struct file *, void *, unsigned, off_t, bool);
+static int transferIovec(struct file *, const struct iovec *, int, bool);
+/* === ADD END p4q22 ===*/
+/* === ADD END p4q20 ===*/
 
 /* === ADD END jinho p2q2 ===*/
 
@@ -63,9 +112,6 @@ void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  /* === ADD START jinho p2q2 ===*/
-  lock_init(&fs_lock);
-  /* === ADD END jinho p2q2 ===*/
 }
 
 /* === DEL START jinho p2q2 ===*/
@@ -80,11 +126,14 @@ syscall_init (void)
 static void
 syscall_handler (struct intr_frame *f)
 {
-  const uint32_t* args[4];
+  /* === MODIFY START p4q19 ===*/
+  const uint32_t* args[5];
   args[0] = f->esp;
   args[1] = (f->esp+4);
   args[2] = (f->esp+8);
   args[3] = (f->esp+12);
+  args[4] = (f->esp+16);
+  /* === MODIFY END p4q19 ===*/
 
   handleInvalidUserPointer(args[0], 4);
   int syscall_number = *(args[0]);
@@ -172,6 +221,68 @@ syscall_handler (struct intr_frame *f)
       munmap( *(args[1]) );
       break;
     /* === ADD END p3q3 ===*/
+    /* === ADD START p4q3 ===*/
+    case SYS_SYNC:
+      sync();
+      break;
+    /* === ADD END p4q3 ===*/
+    /* === ADD START p4q16 ===*/
+    case SYS_IOSTAT:
+      handleInvalidUserPointer(args[1], 4);
+      handleInvalidUserPointer(args[2], 4);
+      {
+        // NOTE : iostat() never fills in more entries than there are
+        //        devices, so clamp cnt before multiplying; a huge cnt
+        //        would otherwise wrap the size around to almost 0.
+        //        stats itself is checked even if cnt is 0 or less.
+        int cnt = (int) *(args[2]);
+        int devCnt = countBlockDevices();
+        if( cnt > devCnt ) { cnt = devCnt; }
+        handleInvalidUserPointerWithWriteable(*(args[1]), cnt > 0 ? cnt * sizeof(struct iostat) : 1 );
+        f->eax = iostat((struct iostat *) *(args[1]), cnt);
+      }
+      break;
+    /* === ADD END p4q16 ===*/
+    /* === ADD START p4q18 ===*/
+    case SYS_COPY_FILE_RANGE:
+      handleInvalidUserPointer(args[1], 4);
+      handleInvalidUserPointer(args[2], 4);
+      handleInvalidUserPointer(args[3], 4);
+      f->eax = copy_file_range(*(args[1]), *(args[2]), *(args[3]));
+      break;
+    /* === ADD END p4q18 ===*/
+    /* === ADD START p4q19 ===*/
+    case SYS_PREAD:
+      handleInvalidUserPointer(args[1], 4);
+      handleInvalidUserPointer(args[2], 4);
+      handleInvalidUserPointer(args[3], 4);
+      handleInvalidUserPointer(args[4], 4);
+      handleInvalidUserPointerWithWriteable(*(args[2]), *(args[3]) );
+      f->eax = pread(*(args[1]), (void *) *(args[2]), *(args[3]), *(args[4]));
+      break;
+    case SYS_PWRITE:
+      handleInvalidUserPointer(args[1], 4);
+      handleInvalidUserPointer(args[2], 4);
+      handleInvalidUserPointer(args[3], 4);
+      handleInvalidUserPointer(args[4], 4);
+      handleInvalidUserPointer(*(args[2]), *(args[3]) );
+      f->eax = pwrite(*(args[1]), (void *) *(args[2]), *(args[3]), *(args[4]));
+      break;
+    /* === ADD END p4q19 ===*/
+    /* === ADD START p4q20 ===*/
+    case SYS_READV:
+      handleInvalidUserPointer(args[1], 4);
+      handleInvalidUserPointer(args[2], 4);
+      handleInvalidUserPointer(args[3], 4);
+      f->eax = readv(*(args[1]), (const struct iovec *) *(args[2]), *(args[3]));
+      break;
+    case SYS_WRITEV:
+      handleInvalidUserPointer(args[1], 4);
+      handleInvalidUserPointer(args[2], 4);
+      handleInvalidUserPointer(args[3], 4);
+      f->eax = writev(*(args[1]), (const struct iovec *) *(args[2]), *(args[3]));
+      break;
+    /* === ADD END p4q20 ===*/
     default:
       // NOTE : invalid system call
       exit(-1);
@@ -229,17 +340,13 @@ int wait(pid_t pid) {
 bool create(const char *file_name, unsigned size){
   bool status;
   if( file_name == NULL ) { return -1; }
-  lock_acquire(&fs_lock);
   status = filesys_create(file_name, size);
-  lock_release(&fs_lock);
   return status;
 }
 
 bool remove(const char *file_name){
   bool status;
-  lock_acquire(&fs_lock);
   status = filesys_remove(file_name);
-  lock_release(&fs_lock);
   return status;
 }
 
@@ -247,7 +354,6 @@ int open(const char *file_name){
   int result = -1;
   if( file_name == NULL ) { return -1; }
   struct thread* cur = thread_current();
-  lock_acquire(&fs_lock);
 
   struct file* f = filesys_open(file_name);
   if( f != NULL ) {
@@ -255,24 +361,20 @@ int open(const char *file_name){
     cur->fd_table[ cur->fd_table_pointer ] = f;
     result = cur->fd_table_pointer;
   }
-  lock_release(&fs_lock);
   return result;
 }
 
 int filesize(int fd){
   int result = -1;
-  lock_acquire(&fs_lock);
   struct file* f = getFilePointer(fd);
   if( f != NULL ) {
     result = file_length(f);
   }
-  lock_release(&fs_lock);
   return result;
 }
 
 int read(int fd, void *buffer, unsigned size){
   int result = -1;
-  lock_acquire(&fs_lock);
   // case) accessing stdin
   if( fd == FD_STDIN_NUM ){
     unsigned count = size;
@@ -285,16 +387,15 @@ int read(int fd, void *buffer, unsigned size){
   else {
     struct file* f = getFilePointer(fd);
     if( f != NULL ) {
-      result = file_read(f, buffer, size);
+      // === MODIFY p4q22 === //
+      result = transferUserBuffer(f, buffer, size, -1, false);
     }
   }
-  lock_release(&fs_lock);
   return result;
 }
 
 int write(int fd, const void *buffer, unsigned size){
   int result = -1;
-  lock_acquire(&fs_lock);
   // case) accessing stdout
   if( fd == FD_STDOUT_NUM ){
     putbuf(buffer, size);
@@ -304,43 +405,37 @@ int write(int fd, const void *buffer, unsigned size){
   else {
     struct file* f = getFilePointer(fd);
     if( f != NULL ) {
-      result = file_write(f, buffer, size);
+      // === MODIFY p4q22 === //
+      result = transferUserBuffer(f, (void *) buffer, size, -1, true);
     }
   }
-  lock_release(&fs_lock);
   return result;
 }
 
 void seek(int fd, unsigned position){
-  lock_acquire(&fs_lock);
   struct file* f = getFilePointer(fd);
   if( f != NULL ) {
     file_seek(f, position);
   }
-  lock_release(&fs_lock);
   return;
 }
 
 unsigned tell(int fd){
   int result = -1;
-  lock_acquire(&fs_lock);
   struct file* f = getFilePointer(fd);
   if( f != NULL ) {
     result = file_tell(f);
   }
-  lock_release(&fs_lock);
   return result;
 }
 
 void close(int fd){
-  lock_acquire(&fs_lock);
   struct thread* cur = thread_current();
   struct file* f = getFilePointer(fd);
   if( f != NULL ) {
     file_close(f);
     cur->fd_table[fd] = NULL;
   }
-  lock_release(&fs_lock);
   return;
 }
 /* === ADD END jinho p2q2 ===*/
@@ -354,7 +449,6 @@ mapid_t mmap(int fd, void* addr) {
   if( check_mmap_availability( fd, addr ) == false) { return -1; }
 
   // from now on, file is assumed to be open, consider the lock
-  lock_acquire(&fs_lock);
   bool success = true;
 
   // file_reopen
@@ -375,7 +469,6 @@ mapid_t mmap(int fd, void* addr) {
                      // manually deallocate pmes
   list_push_back( &(thread_current()->mmap_list), &(mmeta->elem) );
 
-  lock_release(&fs_lock);
   // return mapid
   if( success == false) {
     free( mmeta );
@@ -391,12 +484,10 @@ void munmap(mapid_t mapping) {
   ASSERT(mmeta != NULL);
 
   // clear all pmes
-  lock_acquire(&fs_lock);
   ASSERT( unload_mmap( mmeta ) == true );
 
   // close file
   file_close( mmeta->file );
-  lock_release(&fs_lock);
 
   // pop and deallocate mmap_meta
   list_remove( &(mmeta->elem) );
@@ -406,6 +497,124 @@ void munmap(mapid_t mapping) {
 }
 /* === ADD END p3q3 ===*/
 
+/* === ADD START p4q3 ===*/
+// NOTE : the buffer cache and the free map synchronize
+//        themselves, so no lock is needed to write them back.
+void sync(void) {
+  filesys_sync();
+}
+/* === ADD END p4q3 ===*/
+
+/* === ADD START p4q16 ===*/
+// NOTE : fills in stats of up to cnt block devices, in probe order,
+//        and returns the number of devices, so that the caller can
+//        tell whether its array was large enough.
+int iostat(struct iostat *stats, int cnt) {
+  struct block *b;
+  int n = 0;
+  for( b = block_first() ; b != NULL ; b = block_next(b), n++ ) {
+    if( n < cnt ) {
+      // take the snapshot on the kernel stack, so that no fault on
+      // the user buffer happens with interrupts off.
+      struct iostat stat;
+      block_get_stats(b, &stat);
+      memcpy(&stats[n], &stat, sizeof stat);
+    }
+  }
+  return n;
+}
+
+// NOTE : returns the number of block devices, i.e. the most entries
+//        that iostat() will ever fill in.
+static int countBlockDevices(void) {
+  struct block *b;
+  int n = 0;
+  for( b = block_first() ; b != NULL ; b = block_next(b) ) { n++; }
+  return n;
+}
+/* === ADD END p4q16 ===*/
+
+/* === ADD START p4q18 ===*/
+// NOTE : copies up to size bytes between two open files inside the
+//        kernel, so no data crosses the user/kernel boundary and
+//        no user buffer needs to be validated.
+int copy_file_range(int fd_in, int fd_out, unsigned size) {
+  struct file* in = getFilePointer(fd_in);
+  struct file* out = getFilePointer(fd_out);
+  if( in == NULL || out == NULL ) { return -1; }
+  if( size > INT32_MAX ) { size = INT32_MAX; }
+  return file_copy(out, in, size);
+}
+/* === ADD END p4q18 ===*/
+
+/* === ADD START p4q19 ===*/
+// NOTE : like read() and write() on a file, but at the given offset
+//        rather than the fd's position, which they leave unchanged,
+//        so that threads sharing an fd do not race on it.
+int pread(int fd, void *buffer, unsigned size, unsigned offset) {
+  struct file* f = getFilePointer(fd);
+  if( f == NULL || (off_t) offset < 0 ) { return -1; }
+  // === MODIFY p4q22 === //
+  return transferUserBuffer(f, buffer, size, offset, false);
+}
+
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset) {
+  struct file* f = getFilePointer(fd);
+  if( f == NULL || (off_t) offset < 0 ) { return -1; }
+  // === MODIFY p4q22 === //
+  return transferUserBuffer(f, (void *) buffer, size, offset, true);
+}
+/* === ADD END p4q19 ===*/
+
+/* === ADD START p4q20 ===*/
+// NOTE : the iovec is copied into the kernel and checked once, then
+//        its segments are transferred in one pass through the inode
+//        (one data lock acquisition, one transaction) per chunk of
+//        PIN_CHUNK_PAGES pages.
+int readv(int fd, const struct iovec *uiov, int iov_cnt) {
+  struct iovec iov[IOV_MAX];
+  if( !copyInIovec(iov, uiov, iov_cnt, true) ) { return -1; }
+
+  // case) accessing stdin
+  if( fd == FD_STDIN_NUM ){
+    int result = 0;
+    for( int i = 0 ; i < iov_cnt ; i++ ) {
+      char *bufToInsert = iov[i].iov_base;
+      for( size_t count = iov[i].iov_len ; count > 0 ; count-- ) {
+        *(bufToInsert++) = input_getc();
+      }
+      result += iov[i].iov_len;
+    }
+    return result;
+  }
+  // case) accessing file read
+  struct file* f = getFilePointer(fd);
+  if( f == NULL ) { return -1; }
+  // === MODIFY p4q22 === //
+  return transferIovec(f, iov, iov_cnt, false);
+}
+
+int writev(int fd, const struct iovec *uiov, int iov_cnt) {
+  struct iovec iov[IOV_MAX];
+  if( !copyInIovec(iov, uiov, iov_cnt, false) ) { return -1; }
+
+  // case) accessing stdout
+  if( fd == FD_STDOUT_NUM ){
+    int result = 0;
+    for( int i = 0 ; i < iov_cnt ; i++ ) {
+      putbuf(iov[i].iov_base, iov[i].iov_len);
+      result += iov[i].iov_len;
+    }
+    return result;
+  }
+  // case) accessing file write
+  struct file* f = getFilePointer(fd);
+  if( f == NULL ) { return -1; }
+  // === MODIFY p4q22 === //
+  return transferIovec(f, iov, iov_cnt, true);
+}
+/* === ADD END p4q20 ===*/
+
 
 /* === ADD START jinho p2q2 ===*/
 
@@ -476,6 +685,137 @@ struct thread* getChildPointer(struct thread* cur, tid_t child_tid){
   return out;
 }
 
+/* === ADD START p4q20 ===*/
+// NOTE : copies iov_cnt segments from user iovec uiov into iov, and
+//        checks every segment's buffer (writable, if to be read
+//        into).  Kills the process on a bad pointer; returns false
+//        for a bad count or a total length past the largest off_t.
+static bool copyInIovec(struct iovec *iov, const struct iovec *uiov, int iov_cnt, bool writable){
+  if( iov_cnt < 0 || iov_cnt > IOV_MAX ){ return false; }
+  handleInvalidUserPointer(uiov, iov_cnt * sizeof(struct iovec));
+  memcpy(iov, uiov, iov_cnt * sizeof(struct iovec));
+
+  size_t total = 0;
+  for( int i = 0 ; i < iov_cnt ; i++ ) {
+    if( iov[i].iov_len > (size_t) INT32_MAX - total ){ return false; }
+    total += iov[i].iov_len;
+    _handleInvalidUserPointer(iov[i].iov_base, iov[i].iov_len, writable);
+  }
+  return true;
+}
+/* === ADD END p4q20 ===*/
+
+/* === ADD START p4q22 ===*/
+// NOTE : pins every page of a (validated) user buffer before the
+//        file system is entered, so that the buffer is neither
+//        evicted nor faulted in while file system locks are held.
+//        callers keep the buffer within PIN_CHUNK_PAGES pages.
+static void pinUserBuffer(const void *buffer, unsigned size){
+  if( size == 0 ){ return; }
+  const void *upage = pg_round_down(buffer);
+  for( ; upage < buffer + size ; upage += PGSIZE ) {
+    frame_pin_user(upage);
+  }
+}
+
+static void unpinUserBuffer(const void *buffer, unsigned size){
+  if( size == 0 ){ return; }
+  const void *upage = pg_round_down(buffer);
+  for( ; upage < buffer + size ; upage += PGSIZE ) {
+    frame_unpin_user(upage);
+  }
+}
+
+static void pinIovec(const struct iovec *iov, int iov_cnt){
+  for( int i = 0 ; i < iov_cnt ; i++ ) {
+    pinUserBuffer(iov[i].iov_base, iov[i].iov_len);
+  }
+}
+
+static void unpinIovec(const struct iovec *iov, int iov_cnt){
+  for( int i = 0 ; i < iov_cnt ; i++ ) {
+    unpinUserBuffer(iov[i].iov_base, iov[i].iov_len);
+  }
+}
+
+// NOTE : returns how many of the size bytes at buffer lie within the
+//        first pageCnt pages, starting at buffer's own page.
+static unsigned pinChunkSize(const void *buffer, unsigned size, unsigned pageCnt){
+  unsigned limit = pg_round_down(buffer) + pageCnt * PGSIZE - buffer;
+  return size < limit ? size : limit;
+}
+
+// NOTE : reads (or writes) size bytes between f and a user buffer,
+//        PIN_CHUNK_PAGES pages at a time, each chunk pinned only
+//        while it is transferred.  offset < 0 means f's position.
+//        stops at the first short chunk, like file_read() would.
+static int transferUserBuffer(struct file *f, void *buffer, unsigned size, off_t offset, bool isWrite){
+  unsigned done = 0;
+  while( done < size ) {
+    void *chunk = buffer + done;
+    unsigned chunkSize = pinChunkSize(chunk, size - done, PIN_CHUNK_PAGES);
+    off_t n;
+
+    pinUserBuffer(chunk, chunkSize);
+    if( offset < 0 ) {
+      n = isWrite ? file_write(f, chunk, chunkSize)
+                  : file_read(f, chunk, chunkSize);
+    } else {
+      n = isWrite ? file_write_at(f, chunk, chunkSize, offset + done)
+                  : file_read_at(f, chunk, chunkSize, offset + done);
+    }
+    unpinUserBuffer(chunk, chunkSize);
+
+    done += n;
+    if( (unsigned) n < chunkSize ) { break; }
+  }
+  return done;
+}
+
+// NOTE : like transferUserBuffer(), for the segments of iov: each
+//        chunk takes up to PIN_CHUNK_PAGES pages' worth of segments,
+//        cutting a segment where the pages run out, and goes to
+//        the file system as one file_readv() or file_writev().
+static int transferIovec(struct file *f, const struct iovec *iov, int iov_cnt, bool isWrite){
+  struct iovec chunk[IOV_MAX];
+  int seg = 0;            // current segment of iov
+  size_t segDone = 0;     // bytes of it already transferred
+  int done = 0;
+
+  while( seg < iov_cnt ) {
+    int chunkCnt = 0;
+    unsigned pageCnt = 0;
+    size_t chunkSize = 0;
+
+    // NOTE : a segment contributes at most once to a chunk, so the
+    //        chunk never has more than iov_cnt segments.
+    while( seg < iov_cnt && pageCnt < PIN_CHUNK_PAGES ) {
+      void *base = iov[seg].iov_base + segDone;
+      size_t len = pinChunkSize(base, iov[seg].iov_len - segDone,
+                                PIN_CHUNK_PAGES - pageCnt);
+      if( len > 0 ) {
+        chunk[chunkCnt].iov_base = base;
+        chunk[chunkCnt].iov_len = len;
+        chunkCnt++;
+        pageCnt += (pg_round_up(base + len) - pg_round_down(base)) / PGSIZE;
+        chunkSize += len;
+        segDone += len;
+      }
+      if( segDone == iov[seg].iov_len ) { seg++; segDone = 0; }
+    }
+
+    pinIovec(chunk, chunkCnt);
+    off_t n = isWrite ? file_writev(f, chunk, chunkCnt)
+                      : file_readv(f, chunk, chunkCnt);
+    unpinIovec(chunk, chunkCnt);
+
+    done += n;
+    if( (size_t) n < chunkSize ) { break; }
+  }
+  return done;
+}
+/* === ADD END p4q22 ===*/
+
 // NOTE : will return NULL if file is not opened or invalid, otherwise file*
 //        accessing FD 0, 1, 2 will also return NULL
 static struct file* getFilePointer(int fd){
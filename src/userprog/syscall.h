@@ -9,10 +9,9 @@ typedef int pid_t;
 void syscall_init (void);
 
 /* === ADD START jinho p2q2 ===*/
-// NOTE : define lock to guarantee only one thread is accessing
-//        filesystem at a time. Since pintos is a single-core system,
-//        it is okay to maintain 1 lock to the filesystem.
-struct lock fs_lock;
+// NOTE : the filesystem synchronizes itself with per-inode,
+//        per-directory and free map locks (p4q11), so system
+//        calls no longer take a global filesystem lock.
 
 // NOTE : helper functions (globally used)
 struct thread* getChildPointer(struct thread*, tid_t);
@@ -7,208 +7,764 @@
 #include "threads/synch.h"
 #include "userprog/pagedir.h"
 #include "vm/swap.h"
+/* === ADD START p4q21 ===*/
+#include <round.h>
+#include "threads/palloc.h"
+/* === ADD END p4q21 ===*/
+/* === ADD START p4q23 ===*/
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+/* === ADD END p4q23 ===*/
 
 
 // NOTE : the frame table is globally declared.
 //        i.e. all processes shares a single frame table.
-static struct list frame_table;
+/* === MODIFY START p4q21 ===*/
+// NOTE : it is a dense array with one frame per user pool page,
+//        so that the frame of a page is found by index, and the
+//        clock hand is an index that walks the array.
+static struct frame* frame_table;
+static size_t frame_cnt;        // number of frames (user pool pages)
+static size_t frame_used_cnt;   // number of frames in use
+static uint8_t* frame_base;     // kernel address of frame 0
+/* === MODIFY END p4q21 ===*/
 static struct frame* victim;
-static struct lock victim_lock;
-
-static struct list_elem* _circular_next( struct list_elem* );
-
-void frame_table_init() {
-  list_init ( &frame_table );
+/* === MODIFY START p4q22 ===*/
+// NOTE : FRAME_LOCK protects the frame table (every frame's fields)
+//        and VICTIM, and the LOAD_STATUS and FRAME of every pme
+//        that is loaded.  It is only held for bookkeeping, never
+//        across I/O.  FRAME_COND is broadcast whenever a frame is
+//        unpinned, freed, or done being evicted.
+static struct lock frame_lock;
+static struct condition frame_cond;
+/* === MODIFY END p4q22 ===*/
+
+/* === MODIFY p4q21 === */
+static struct frame* _circular_next( struct frame* );
+
+/* === ADD START p4q23 ===*/
+// NOTE : a page replacement policy.  every hook is called with
+//        the frame lock held, and may be NULL.
+struct frame_policy {
+  const char* name;
+
+  // sets VICTIM to an evictable frame and returns true, or
+  // returns false if there is none.
+  bool (*choose) ( void );
+  // the page of pme F->PME was just loaded into F.
+  void (*install) ( struct frame* f );
+  // F was chosen and is about to be evicted.
+  void (*evict) ( struct frame* f );
+  // F is freed while its page is still loaded.
+  void (*free) ( struct frame* f );
+};
+
+static const struct frame_policy* policy;
+
+// NOTE : statistics, protected by the frame lock.
+static long long page_in_cnt;     // pages loaded into a frame
+static long long evict_cnt;       // pages evicted
+static long long write_back_cnt;  // evictions that wrote the page out
+
+static void clockpro_init( void );
+/* === ADD END p4q23 ===*/
+
+/* === ADD START p4q25 ===*/
+// NOTE : the swap writer.  a victim whose page must go to swap is
+//        queued here rather than written by the faulting thread,
+//        and the writer thread writes the queue as one batch to
+//        contiguous slots, then frees the frames to the user pool.
+//        protected by the frame lock.
+#define WRITE_BATCH SWAP_CLUSTER_MAX
+static struct frame* write_queue[WRITE_BATCH];
+static size_t write_queue_cnt;      // frames queued
+static size_t write_pending_cnt;    // frames queued or being written
+static bool writer_started;
+static struct condition write_queue_ready;
+
+static void swap_writer( void* aux );
+static bool _needs_write( struct frame* );
+/* === ADD END p4q25 ===*/
+
+/* === MODIFY START p4q21 ===*/
+// NOTE : BASE and CNT describe the user pool.
+//        The array itself comes from the kernel pool.
+void frame_table_init( void* base, size_t cnt ) {
+  size_t pages = DIV_ROUND_UP( cnt * sizeof( struct frame ), PGSIZE );
+  frame_table = palloc_get_multiple( PAL_ASSERT | PAL_ZERO, pages );
+  frame_cnt = cnt;
+  frame_used_cnt = 0;
+  frame_base = base;
+  for( size_t i = 0 ; i < cnt ; i++ ) {
+    frame_table[i].kaddr = frame_base + i * PGSIZE;
+  }
   victim = NULL;
-  //lock_init( &victim_lock );
+  /* === MODIFY START p4q22 ===*/
+  lock_init( &frame_lock );
+  cond_init( &frame_cond );
+  /* === MODIFY END p4q22 ===*/
+  /* === ADD START p4q25 ===*/
+  write_queue_cnt = write_pending_cnt = 0;
+  writer_started = false;
+  cond_init( &write_queue_ready );
+  /* === ADD END p4q25 ===*/
+  /* === ADD START p4q23 ===*/
+  if( policy == NULL ) { frame_policy_select( "clock" ); }
+  clockpro_init();
+  /* === ADD END p4q23 ===*/
   return;
 }
+/* === MODIFY END p4q21 ===*/
 
 // NOTE : here, vaddr is not inserted.
+/* === ADD START p4q22 ===*/
+// NOTE : the new frame is pinned, so that it is not evicted
+//        while its owner fills it, until frame_install_pme().
+/* === ADD END p4q22 ===*/
 struct frame* create_frame ( void* kaddr, struct thread* thr ) {
-  struct frame* frame = malloc ( sizeof( struct frame ) );
-  frame->kaddr = kaddr;
+  /* === MODIFY START p4q21 ===*/
+  struct frame* frame = find_frame( kaddr );
+  ASSERT( frame != NULL && !frame->in_use );
+  /* === MODIFY END p4q21 ===*/
+  /* === ADD p4q22 === */
+  lock_acquire( &frame_lock );
   frame->vaddr = NULL;
   frame->vaddr_installed = false;
   frame->thr = thr;
+  /* === ADD START p4q22 ===*/
+  frame->pme = NULL;
+  frame->pin_cnt = 1;
+  frame->busy = false;
+  /* === ADD p4q23 === */
+  frame->hot = false;
+  lock_release( &frame_lock );
+  /* === ADD END p4q22 ===*/
 
   return frame;
 }
 
 void install_vaddr_to_frame ( struct frame* f, void* vaddr ) {
+  /* === ADD p4q22 === */
+  lock_acquire( &frame_lock );
   f->vaddr = vaddr;
   f->vaddr_installed = true;
+  /* === ADD p4q22 === */
+  lock_release( &frame_lock );
 }
 
-struct frame* find_frame( void* kaddr ) {
+/* === ADD START p4q22 ===*/
+// NOTE : called by the owner once the page at KADDR is loaded and
+//        installed for pme E.  From then on the frame can be
+//        evicted, and E tells which frame holds it.
+void frame_install_pme( void* kaddr, struct pme* e ) {
+  struct frame* f = find_frame( kaddr );
+  ASSERT( f != NULL );
+
+  lock_acquire( &frame_lock );
+  ASSERT( f->in_use && f->pin_cnt > 0 && f->pme == NULL );
+  f->pme = e;
+  e->frame = f;
+  e->load_status = true;
+  /* === ADD START p4q23 ===*/
+  f->last_use = timer_ticks();
+  page_in_cnt++;
+  if( policy->install != NULL ) { policy->install( f ); }
+  /* === ADD END p4q23 ===*/
+  f->pin_cnt--;
+  if( f->pin_cnt == 0 ) { cond_broadcast( &frame_cond, &frame_lock ); }
+  lock_release( &frame_lock );
+}
+
+// NOTE : waits until pme E is not being evicted.  Then, if E is
+//        loaded, pins its frame so that it stays loaded, and
+//        returns true.  Returns false if E is not loaded.
+bool frame_pin_pme( struct pme* e ) {
+  bool loaded;
+
+  lock_acquire( &frame_lock );
+  while( e->frame != NULL && e->frame->busy ) {
+    cond_wait( &frame_cond, &frame_lock );
+  }
+  loaded = e->frame != NULL;
+  if( loaded ) { e->frame->pin_cnt++; }
+  lock_release( &frame_lock );
+  return loaded;
+}
 
-  //lock_acquire( &victim_lock );
+// NOTE : undoes a successful frame_pin_pme().
+void frame_unpin_pme( struct pme* e ) {
+  lock_acquire( &frame_lock );
+  ASSERT( e->frame != NULL && e->frame->pin_cnt > 0 );
+  e->frame->pin_cnt--;
+  if( e->frame->pin_cnt == 0 ) { cond_broadcast( &frame_cond, &frame_lock ); }
+  lock_release( &frame_lock );
+}
+
+// NOTE : pins the frame holding the current process's page that
+//        contains UADDR, loading it first if needed, so that a
+//        syscall can access it while holding file system locks
+//        without faulting.  UADDR must have a pme.
+void frame_pin_user( const void* uaddr ) {
+  struct thread* cur = thread_current();
+  void* upage = pg_round_down( uaddr );
+  struct pme* e = pmap_get_pme( &(cur->pmap), upage );
+  ASSERT( e != NULL );
+
+  // NOTE : the page may be evicted again between the touch and
+  //        the pin, so retry until it is pinned while loaded.
+  while( !frame_pin_pme( e ) ) {
+    volatile uint8_t touch = *(volatile uint8_t*) upage;
+    (void) touch;
+  }
+}
+
+// NOTE : undoes frame_pin_user().
+void frame_unpin_user( const void* uaddr ) {
+  struct thread* cur = thread_current();
+  struct pme* e = pmap_get_pme( &(cur->pmap), pg_round_down( uaddr ) );
+  ASSERT( e != NULL );
+  frame_unpin_pme( e );
+}
+/* === ADD END p4q22 ===*/
+
+/* === MODIFY START p4q21 ===*/
+// NOTE : returns the frame of a user pool page in O(1),
+//        or NULL if KADDR is not in the user pool.
+struct frame* find_frame( void* kaddr ) {
 
   ASSERT (pg_ofs (kaddr) == 0);
 
-  struct list_elem *e;
-  for ( e = list_begin (&frame_table);
-        e != list_end (&frame_table);
-        e = list_next (e)       )
-    {
-        struct frame *f = list_entry(e, struct frame, elem);
-        if( f->kaddr == kaddr ) { // found
-          return f;
-        }
-    }
-//  lock_release( &victim_lock );
-  return NULL; // not found
+  if( (uint8_t*) kaddr < frame_base ) { return NULL; }
+  size_t idx = ( (uint8_t*) kaddr - frame_base ) / PGSIZE;
+  if( idx >= frame_cnt ) { return NULL; }
+  return &frame_table[idx];
 }
 
 void insert_frame( struct frame* f ){
-//  lock_acquire( &victim_lock );
-  list_push_back( &frame_table, &(f->elem) );
-//  lock_release( &victim_lock );
-
+  /* === ADD p4q22 === */
+  lock_acquire( &frame_lock );
+  ASSERT( !f->in_use );
+  f->in_use = true;
+  frame_used_cnt++;
+  /* === ADD p4q22 === */
+  lock_release( &frame_lock );
 }
 
 void remove_frame( struct frame* f ) {
-//  lock_acquire( &victim_lock );
-  list_remove( &(f->elem) );
-  free( f );
-//  lock_release( &victim_lock );
+  /* === ADD p4q22 === */
+  lock_acquire( &frame_lock );
+  ASSERT( f->in_use );
+  f->in_use = false;
+  f->vaddr_installed = false;
+  frame_used_cnt--;
+  /* === ADD START p4q22 ===*/
+  if( f->pme != NULL ) {
+    /* === ADD p4q23 === */
+    if( policy->free != NULL ) { policy->free( f ); }
+    f->pme->frame = NULL;
+    f->pme = NULL;
+  }
+  f->pin_cnt = 0;
+  f->busy = false;
+  cond_broadcast( &frame_cond, &frame_lock );
+  lock_release( &frame_lock );
+  /* === ADD END p4q22 ===*/
 }
+/* === MODIFY END p4q21 ===*/
 
 /* Page Replacement Related */
 
-// NOTE: 1. proceed (swap/flush)
-//       2. update pme (not loaded)
-//       3. uninstall from pagedir
+/* === MODIFY START p4q22 ===*/
+// NOTE: the victim F was chosen by frame_choose_victim(), which
+//       marked it busy and uninstalled it from the pagedir, so
+//       that its owner faults and waits instead of touching it.
+//       1. proceed (swap/flush), without any lock held
+//       2. update pme (not loaded) and release the frame
 bool evict_page( struct frame* f ) {
 
   bool success = true;
+  /* === ADD p4q23 === */
+  bool written = true;
   ASSERT( f != NULL );
-  ASSERT( f->vaddr_installed == true );
+  ASSERT( f->busy && f->pme != NULL );
 
-  // get pme of that frame
-  struct pme* pme = pmap_get_pme( &(f->thr->pmap), f->vaddr );
+  struct pme* pme = f->pme;
   ASSERT( pme->load_status == true );
 
   switch( pme->type ) {
     case PME_MMAP: {
-      void* kaddr = pagedir_get_page( f->thr->pagedir, pme->vaddr );
-      pmap_flush_pme_data( pme, kaddr );
+      // NOTE : the dirty bit survives pagedir_clear_page(), and no
+      //        new write can set it once the page is uninstalled.
+      if( pagedir_is_dirty( f->thr->pagedir, pme->vaddr ) ) {
+        success = pmap_writeback_pme_data( pme, f->kaddr );
+      }
+      /* === ADD p4q23 === */
+      else { written = false; }
       break;
     }
-    case PME_NULL :
+    /* === MODIFY START p4q24 ===*/
+    // NOTE : a clean exec page is identical to its bytes in the
+    //        executable, so it is dropped and read back from there
+    //        on the next fault.  once dirtied, it goes to swap and
+    //        stays a swap page.
     case PME_EXEC :  {
-      void* kaddr = pagedir_get_page( f->thr->pagedir, pme->vaddr );
+      if( !pagedir_is_dirty( f->thr->pagedir, pme->vaddr ) ) {
+        written = false;
+        break;
+      }
       pme->type = PME_SWAP;
-      pme->pme_swap_index = swap_out( kaddr );
+      pme->pme_swap_index = swap_out( f->kaddr );
       break;
     }
+    case PME_NULL :  {
+      pme->type = PME_SWAP;
+      pme->pme_swap_index = swap_out( f->kaddr );
+      break;
+    }
+    /* === MODIFY END p4q24 ===*/
     case PME_SWAP : {
-      void* kaddr = pagedir_get_page( f->thr->pagedir, pme->vaddr );
-      pme->pme_swap_index = swap_out( kaddr );
+      pme->pme_swap_index = swap_out( f->kaddr );
       break;
     }
     default: { ASSERT(0); }
   }
 
+  lock_acquire( &frame_lock );
+  /* === ADD p4q23 === */
+  if( written ) { write_back_cnt++; }
   pme->load_status = false;
-  pagedir_clear_page( f->thr->pagedir, pme->vaddr );
+  pme->frame = NULL;
+  f->pme = NULL;
+  f->vaddr_installed = false;
+  f->busy = false;
+  cond_broadcast( &frame_cond, &frame_lock );
+  lock_release( &frame_lock );
 
   return success;
 }
+/* === MODIFY END p4q22 ===*/
+
+/* === DEL START p4q22 ===*/
+//// NOTE : this function must be stateless.
+////        the result of this function ONLY
+////        depends on VICTIM.
+//struct frame* get_current_victim() {
+////  lock_acquire( &victim_lock );
+//  if( victim == NULL ) {
+//    set_next_victim();
+//  }
+//  struct frame* f = victim;
+////  lock_release( &victim_lock );
+//
+//  // NOTE : if victim cannot be selected,
+//  //        that would be a very serious problem
+//  //        reasonable to panic
+//  ASSERT( f != NULL );
+//  return f;
+//}
+/* === DEL END p4q22 ===*/
+
+/* === ADD START p4q22 ===*/
+// NOTE : chooses a frame to evict, marks it busy and uninstalls
+//        it from its owner's pagedir, all under the frame lock,
+//        and returns it.  Waits if every frame is pinned or busy.
+/* === ADD START p4q25 ===*/
+// NOTE : a victim that would go to swap is queued to the swap
+//        writer instead, and another one is chosen, so that the
+//        frame returned needs no swap write.  if there is none,
+//        waits for the writer and returns NULL; by then it has
+//        freed frames to the user pool, to be allocated again.
+/* === ADD END p4q25 ===*/
+struct frame* frame_choose_victim() {
+  struct frame* f;
+
+  lock_acquire( &frame_lock );
+  /* === MODIFY START p4q25 ===*/
+  for( ; ; ) {
+    if( write_queue_cnt == WRITE_BATCH ) { f = NULL; break; }
+    /* === MODIFY p4q23 === */
+    if( !policy->choose() ) {
+      if( write_pending_cnt > 0 ) { f = NULL; break; }
+      cond_wait( &frame_cond, &frame_lock );
+      continue;
+    }
+    f = victim;
+    f->busy = true;
+    /* === ADD START p4q23 ===*/
+    evict_cnt++;
+    if( policy->evict != NULL ) { policy->evict( f ); }
+    /* === ADD END p4q23 ===*/
+    pagedir_clear_page( f->thr->pagedir, f->vaddr );
+
+    // NOTE : the pte is cleared first, so the dirty bit is final.
+    if( !writer_started || f->pme->type == PME_MMAP || !_needs_write( f ) ) {
+      break;
+    }
+    write_queue[write_queue_cnt++] = f;
+    write_pending_cnt++;
+  }
 
-// NOTE : this function must be stateless.
-//        the result of this function ONLY
-//        depends on VICTIM.
-struct frame* get_current_victim() {
-//  lock_acquire( &victim_lock );
-  if( victim == NULL ) {
-    set_next_victim();
+  if( f == NULL ) {
+    // NOTE : every frame the writer frees is broadcast.
+    if( write_queue_cnt > 0 ) { cond_signal( &write_queue_ready, &frame_lock ); }
+    cond_wait( &frame_cond, &frame_lock );
+  } else if( write_queue_cnt > 0 ) {
+    cond_signal( &write_queue_ready, &frame_lock );
   }
-  struct frame* f = victim;
-//  lock_release( &victim_lock );
+  /* === MODIFY END p4q25 ===*/
+  lock_release( &frame_lock );
 
-  // NOTE : if victim cannot be selected,
-  //        that would be a very serious problem
-  //        reasonable to panic
-  ASSERT( f != NULL );
   return f;
 }
 
+/* === ADD START p4q25 ===*/
+// NOTE : starts the swap writer.  until then, victims are written
+//        to swap by evict_page().
+void frame_writer_init( void ) {
+  lock_acquire( &frame_lock );
+  writer_started = true;
+  lock_release( &frame_lock );
+  thread_create( "swap-writer", PRI_DEFAULT, swap_writer, NULL );
+}
+
+// NOTE : takes the whole queue, writes it out with the swap lock
+//        held only to reserve slots, marks the pages swapped out,
+//        and frees their frames.
+static void swap_writer( void* aux UNUSED ) {
+  struct frame* batch[WRITE_BATCH];
+  void* pages[WRITE_BATCH];
+  st_idx slots[WRITE_BATCH];
+
+  for( ; ; ) {
+    lock_acquire( &frame_lock );
+    while( write_queue_cnt == 0 ) {
+      cond_wait( &write_queue_ready, &frame_lock );
+    }
+    size_t cnt = write_queue_cnt;
+    memcpy( batch, write_queue, cnt * sizeof *batch );
+    write_queue_cnt = 0;
+    lock_release( &frame_lock );
+
+    for( size_t i = 0 ; i < cnt ; i++ ) { pages[i] = batch[i]->kaddr; }
+    swap_out_multi( pages, cnt, slots );
+
+    lock_acquire( &frame_lock );
+    for( size_t i = 0 ; i < cnt ; i++ ) {
+      struct frame* f = batch[i];
+      struct pme* pme = f->pme;
+      pme->type = PME_SWAP;
+      pme->pme_swap_index = slots[i];
+      pme->load_status = false;
+      pme->frame = NULL;
+      f->pme = NULL;
+      f->vaddr_installed = false;
+      write_back_cnt++;
+    }
+    write_pending_cnt -= cnt;
+    lock_release( &frame_lock );
+
+    // NOTE : each remove_frame() wakes the threads waiting for them.
+    for( size_t i = 0 ; i < cnt ; i++ ) { palloc_free_page( batch[i]->kaddr ); }
+  }
+}
+/* === ADD END p4q25 ===*/
+
+// NOTE : whether F may be evicted now.
+static bool _is_evictable( struct frame* f ) {
+  return f->in_use && f->vaddr_installed && f->pme != NULL
+         && f->pin_cnt == 0 && !f->busy;
+}
+/* === ADD END p4q22 ===*/
+
+/* === ADD START p4q23 ===*/
+// NOTE : whether evicting F would have to write its page out.
+static bool _needs_write( struct frame* f ) {
+  /* === MODIFY p4q24 === */
+  if( f->pme->type == PME_MMAP || f->pme->type == PME_EXEC ) {
+    return pagedir_is_dirty( f->thr->pagedir, f->vaddr );
+  }
+  return true;   // other pages always go to swap
+}
+
+static bool _test_and_clear_accessed( struct frame* f ) {
+  bool accessed = pagedir_is_accessed( f->thr->pagedir, f->vaddr );
+  if( accessed ) { pagedir_set_accessed( f->thr->pagedir, f->vaddr, false ); }
+  return accessed;
+}
+
+// NOTE : where the clock hand starts its next sweep.
+static struct frame* _hand_start( void ) {
+  return victim == NULL ? &frame_table[0] : _circular_next( victim );
+}
+/* === ADD END p4q23 ===*/
+
 // NOTE : here, we implement 2nd chance algorithm
 //        if victim is null, set victim starting from the front
 //        we do not set as victim if vaddr is not installed.
-void set_next_victim() {
+/* === MODIFY START p4q22 ===*/
+// NOTE : nor if it is pinned or busy.  returns false, leaving
+//        VICTIM unchanged, if two sweeps find no victim.
+//        the frame lock must be held.
+bool set_next_victim() {
 
-//  lock_acquire( &victim_lock );
-  ASSERT( list_size(&frame_table) > 0 )
+  ASSERT( lock_held_by_current_thread( &frame_lock ) );
+  size_t steps;
+/* === MODIFY END p4q22 ===*/
+  /* === MODIFY START p4q21 ===*/
 
   // NOTE : we maintain a circular search
-  struct list_elem *e;
+  //        over the array, skipping free frames.
   struct frame* ptr;
   if( victim == NULL ) {
-    e = list_begin(&frame_table);    // e starts from begin
+    ptr = &frame_table[0];           // ptr starts from begin
   } else {
-    e = _circular_next( &(victim->elem) );             // e starts from current victim's next
+    ptr = _circular_next( victim );  // ptr starts from current victim's next
   }
-  for ( ;
-        //e != list_end (&frame_table);
-        ; e = _circular_next (e) )
+  /* === MODIFY p4q22 === */
+  for ( steps = 0 ; steps < 2 * frame_cnt ; steps++, ptr = _circular_next (ptr) )
   {
-    ptr = list_entry(e, struct frame, elem);
-    ASSERT( ptr != NULL );
-    if( ptr->vaddr_installed ) {
-      if( pagedir_is_accessed( &(ptr->thr->pagedir), ptr->vaddr )) {
+    /* === MODIFY p4q22 === */
+    if( _is_evictable( ptr ) ) {
+      // NOTE : the page directory itself, not its address.
+      if( pagedir_is_accessed( ptr->thr->pagedir, ptr->vaddr )) {
         // if accessed == 1, give second chance
-        pagedir_set_accessed( &(ptr->thr->pagedir), ptr->vaddr, false );
+        pagedir_set_accessed( ptr->thr->pagedir, ptr->vaddr, false );
       } else{
         // if accessed == 0, select
         victim = ptr;
-        break;
+        /* === MODIFY p4q22 === */
+        return true;
       }
     }
   }
-//  lock_release( &victim_lock );
+  /* === MODIFY END p4q21 ===*/
+  /* === ADD p4q22 === */
+  return false;
 }
 
 // NOTE : an internal function for circular search
-static struct list_elem* _circular_next( struct list_elem* e ){
-  if ( e == list_rbegin (&frame_table) ) {
-    return list_begin( &frame_table );
+/* === MODIFY START p4q21 ===*/
+static struct frame* _circular_next( struct frame* f ){
+  if ( f == &frame_table[frame_cnt - 1] ) {
+    return &frame_table[0];
   } else {
-    return list_next(e);
+    return f + 1;
+  }
+}
+/* === MODIFY END p4q21 ===*/
+
+/* === ADD START p4q23 ===*/
+// NOTE : enhanced clock.  frames fall into four classes by
+//        (accessed, needs write); the lowest nonempty class is
+//        evicted, so that a clean page goes before a dirty one.
+//        sweeps 1 and 3 look for (0,0) and change nothing,
+//        sweeps 2 and 4 look for (0,1) and clear accessed bits.
+static bool eclock_choose( void ) {
+  struct frame* ptr = _hand_start();
+
+  for( int sweep = 0 ; sweep < 4 ; sweep++ ) {
+    bool want_dirty = sweep % 2 == 1;
+    for( size_t steps = 0 ; steps < frame_cnt ; steps++, ptr = _circular_next( ptr ) ) {
+      if( !_is_evictable( ptr ) ) { continue; }
+      if( want_dirty ) {
+        if( !_test_and_clear_accessed( ptr ) && _needs_write( ptr ) ) {
+          victim = ptr; return true;
+        }
+      } else if( !pagedir_is_accessed( ptr->thr->pagedir, ptr->vaddr )
+                 && !_needs_write( ptr ) ) {
+        victim = ptr; return true;
+      }
+    }
   }
+  return false;
 }
 
-bool is_victim ( struct frame* f ){
-  if( victim == NULL ) { return false; }
-  if( victim == f) { return true; }
+// NOTE : WSClock.  a frame that was not accessed within the last
+//        WSCLOCK_TAU ticks is out of its owner's working set.
+//        the first clean one found is evicted.  we have no
+//        asynchronous write-back to start on the dirty ones, so
+//        failing a clean one, the first dirty one out of the
+//        working set is evicted, then the least recently used.
+#define WSCLOCK_TAU 50
+static bool wsclock_choose( void ) {
+  int64_t now = timer_ticks();
+  struct frame* ptr = _hand_start();
+  struct frame* old_dirty = NULL;
+  struct frame* oldest = NULL;
+
+  for( size_t steps = 0 ; steps < frame_cnt ; steps++, ptr = _circular_next( ptr ) ) {
+    if( !_is_evictable( ptr ) ) { continue; }
+    if( _test_and_clear_accessed( ptr ) ) {
+      ptr->last_use = now;
+      continue;
+    }
+    if( now - ptr->last_use > WSCLOCK_TAU ) {
+      if( !_needs_write( ptr ) ) { victim = ptr; return true; }
+      if( old_dirty == NULL ) { old_dirty = ptr; }
+    }
+    if( oldest == NULL || ptr->last_use < oldest->last_use ) { oldest = ptr; }
+  }
+
+  if( old_dirty != NULL ) { victim = old_dirty; return true; }
+  if( oldest != NULL ) { victim = oldest; return true; }
   return false;
 }
 
-void replace_victim ( struct frame* f ) {
+// NOTE : CLOCK-Pro, simplified.  a page enters cold, and becomes
+//        hot if it is accessed again while cold, or if it faults
+//        back in soon after being evicted from cold (its reuse
+//        distance is within memory size).  only cold pages are
+//        evicted, so a scan touching each page once does not push
+//        out the hot ones.  the hot hand demotes unaccessed hot
+//        pages to keep COLD_TARGET frames cold.  like ARC, the
+//        target adapts: a refault that would have been a hit
+//        grows it, and a refault that would not shrinks it.
+static struct frame* hot_hand;
+static size_t hot_cnt;
+static size_t cold_target;
+
+static void clockpro_init( void ) {
+  hot_hand = NULL;
+  hot_cnt = 0;
+  cold_target = frame_cnt / 2 > 0 ? frame_cnt / 2 : 1;
+}
+
+// NOTE : demotes one hot page, if any is found in a sweep.
+static void _clockpro_run_hot_hand( void ) {
+  struct frame* ptr = hot_hand == NULL ? &frame_table[0] : hot_hand;
+
+  for( size_t steps = 0 ; steps < 2 * frame_cnt ; steps++, ptr = _circular_next( ptr ) ) {
+    if( !ptr->in_use || ptr->pme == NULL || !ptr->hot ) { continue; }
+    if( !_test_and_clear_accessed( ptr ) ) {
+      ptr->hot = false;
+      hot_cnt--;
+      hot_hand = _circular_next( ptr );
+      return;
+    }
+  }
+  hot_hand = ptr;
+}
+
+static bool clockpro_choose( void ) {
+  while( hot_cnt > 0 && hot_cnt + cold_target > frame_used_cnt ) {
+    size_t before = hot_cnt;
+    _clockpro_run_hot_hand();
+    if( hot_cnt == before ) { break; }
+  }
+
+  for( int round = 0 ; round < 2 ; round++ ) {
+    struct frame* ptr = _hand_start();
+    for( size_t steps = 0 ; steps < frame_cnt ; steps++, ptr = _circular_next( ptr ) ) {
+      if( !_is_evictable( ptr ) || ptr->hot ) { continue; }
+      if( _test_and_clear_accessed( ptr ) ) {
+        ptr->hot = true;
+        hot_cnt++;
+        continue;
+      }
+      victim = ptr;
+      return true;
+    }
+    // NOTE : every evictable page is hot.
+    if( hot_cnt == 0 ) { break; }
+    _clockpro_run_hot_hand();
+  }
+  return false;
+}
 
-  struct frame* f_new;
-  int set_cnt = 0;
-  //printf("listsize %d\n", list_size(&frame_table) );
-  do {
-    f_new = get_current_victim();
-    // something serious has happened!
-    set_next_victim();
-    set_cnt +=1;
-    if( set_cnt >= 10 ){
-      // there's something wrong with victim replacement
-      // e.g. if 1 entry remains, we will invalidate the
-      //      victim. the vicitm will be lazily reconfigured
-      //      when eviction is done.
-      victim = NULL ; return;
+static void clockpro_install( struct frame* f ) {
+  struct pme* e = f->pme;
+  if( e->evict_stamp != 0 ) {
+    if( evict_cnt - e->evict_stamp <= (long long) frame_cnt ) {
+      f->hot = true;
+      hot_cnt++;
+      if( cold_target < frame_cnt - 1 ) { cold_target++; }
+    } else if( cold_target > 1 ) {
+      cold_target--;
     }
-  } while ( f_new == f );
+    e->evict_stamp = 0;
+  }
+}
+
+static void clockpro_evict( struct frame* f ) {
+  ASSERT( !f->hot );
+  f->pme->evict_stamp = evict_cnt;
+}
 
-  // NOTE : the replaced victim should never be
-  //        same with the original one.
-  ASSERT( f_new != f ) ;
+static void clockpro_free( struct frame* f ) {
+  if( f->hot ) {
+    f->hot = false;
+    hot_cnt--;
+  }
+}
+
+static const struct frame_policy clock_policy =
+  { "clock", set_next_victim, NULL, NULL, NULL };
+static const struct frame_policy eclock_policy =
+  { "eclock", eclock_choose, NULL, NULL, NULL };
+static const struct frame_policy wsclock_policy =
+  { "wsclock", wsclock_choose, NULL, NULL, NULL };
+static const struct frame_policy clockpro_policy =
+  { "clockpro", clockpro_choose, clockpro_install, clockpro_evict, clockpro_free };
+
+static const struct frame_policy* policies[] =
+  { &clock_policy, &eclock_policy, &wsclock_policy, &clockpro_policy };
+#define POLICY_CNT (sizeof policies / sizeof *policies)
+
+// NOTE : selects the page replacement policy named NAME.
+//        must be called before the frame table is initialized.
+//        returns false if there is no such policy.
+bool frame_policy_select( const char* name ) {
+  for( size_t i = 0 ; i < POLICY_CNT ; i++ ) {
+    if( !strcmp( name, policies[i]->name ) ) {
+      policy = policies[i];
+      return true;
+    }
+  }
+  return false;
+}
 
-  victim = f_new;
+void frame_print_stats( void ) {
+  printf( "Frames: %zu user frames, %s policy, %lld page-ins, "
+          "%lld evictions, %lld write-backs\n",
+          frame_cnt, policy->name, page_in_cnt, evict_cnt, write_back_cnt );
 }
+/* === ADD END p4q23 ===*/
+
+/* === DEL START p4q22 ===*/
+// NOTE : the clock hand skips free frames, so it need not move
+//        off a frame when the frame is freed.
+//bool is_victim ( struct frame* f ){
+//  if( victim == NULL ) { return false; }
+//  if( victim == f) { return true; }
+//  return false;
+//}
+//
+//void replace_victim ( struct frame* f ) {
+//
+//  struct frame* f_new;
+//  int set_cnt = 0;
+//  //printf("listsize %d\n", list_size(&frame_table) );
+//  do {
+//    f_new = get_current_victim();
+//    // something serious has happened!
+//    set_next_victim();
+//    set_cnt +=1;
+//    if( set_cnt >= 10 ){
+//      // there's something wrong with victim replacement
+//      // e.g. if 1 entry remains, we will invalidate the
+//      //      victim. the vicitm will be lazily reconfigured
+//      //      when eviction is done.
+//      victim = NULL ; return;
+//    }
+//  } while ( f_new == f );
+//
+//  // NOTE : the replaced victim should never be
+//  //        same with the original one.
+//  ASSERT( f_new != f ) ;
+//
+//  victim = f_new;
+//}
+/* === DEL END p4q22 ===*/
 
 /* === ADD END p3q4 ===*/
\ No newline at end of file
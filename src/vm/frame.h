@@ -10,15 +10,30 @@
 //        is to resemble the interfaces of palloc
 //        as much as possible.
 //
+// === MODIFY START p4q21 === //
+// NOTE : frames are not malloc'd, but live in a dense array
+//        with one entry per user pool page, indexed by the
+//        page's position in the pool.
 struct frame {
     void*              kaddr;           // kernel memory address
+    bool               in_use;          // whether the page is allocated
     bool               vaddr_installed; // whether vaddr is installed
     void*              vaddr;           // virtual memory address of that page
     struct thread*     thr;             // thread pointer
-    struct list_elem   elem;
+    // === ADD START p4q22 === //
+    struct pme*        pme;             // pme of the loaded page, NULL
+                                        // until frame_install_pme()
+    int                pin_cnt;         // never evicted while nonzero
+    bool               busy;            // being evicted
+    // === ADD END p4q22 === //
+    // === ADD START p4q23 === //
+    int64_t            last_use;        // ticks when last seen accessed
+    bool               hot;             // hot page (clockpro policy)
+    // === ADD END p4q23 === //
 };
 
-void frame_table_init();
+void frame_table_init( void*, size_t );
+// === MODIFY END p4q21 === //
 
 struct frame* create_frame ( void* , struct thread* );
 void install_vaddr_to_frame ( struct frame*, void* );
@@ -26,13 +41,29 @@ struct frame* find_frame( void* );
 void insert_frame( struct frame* );
 void remove_frame( struct frame* );
 
+// === ADD START p4q22 === //
+void frame_install_pme( void*, struct pme* );
+bool frame_pin_pme( struct pme* );
+void frame_unpin_pme( struct pme* );
+void frame_pin_user( const void* );
+void frame_unpin_user( const void* );
+// === ADD END p4q22 === //
+
 /* page replacement related */
 bool evict_page( struct frame* );
 
-struct frame* get_current_victim();
-void set_next_victim();
-bool is_victim ( struct frame* );
-void replace_victim( struct frame* );
+// === MODIFY START p4q22 === //
+struct frame* frame_choose_victim();
+bool set_next_victim();
+// === MODIFY END p4q22 === //
+
+// === ADD START p4q23 === //
+bool frame_policy_select( const char* );
+void frame_print_stats( void );
+// === ADD END p4q23 === //
+
+// === ADD p4q25 === //
+void frame_writer_init( void );
 
 #endif //VM_FRAME_H
 
@@ -29,6 +29,10 @@ struct pme* create_pme (){
   // NOTE : pme_new can be NULL due to memory lackage
   struct pme* pme_new = malloc( sizeof(struct pme) );
   ASSERT( pme_new != NULL ); // (actually this should never happen)
+  /* === ADD p4q22 === */
+  pme_new->frame = NULL;
+  /* === ADD p4q23 === */
+  pme_new->evict_stamp = 0;
   return pme_new;
 }
 
@@ -77,7 +81,10 @@ bool pmap_clear_pme (struct hash* pmap, struct pme* e ){
   struct thread* cur = thread_current();
 
   // if loaded, clear
-  if( pme_lookup -> load_status == true ) {
+  // === MODIFY p4q22 === //
+  // NOTE : pinning waits out an eviction in progress, and keeps
+  //        the page from being chosen until it is freed.
+  if( frame_pin_pme( pme_lookup ) ) {
     void *kaddr = pagedir_get_page(cur->pagedir, e->vaddr);
     // flush mechanism -> operated on munmap
     ASSERT(pmap_flush_pme_data(e, kaddr) == true);
@@ -154,7 +161,8 @@ static void pmap_destroy_function (struct hash_elem *e, void *aux UNUSED){
 
   struct thread* cur = thread_current();
   void* kaddr;
-  if( pme_target -> load_status == true ) {
+  // === MODIFY p4q22 === //
+  if( frame_pin_pme( pme_target ) ) {
     kaddr = pagedir_get_page( cur->pagedir, pme_target->vaddr );
     // NOTE : flush if dirty
     ASSERT( pmap_flush_pme_data(pme_target, kaddr) == true );
@@ -5,6 +5,9 @@
 
 #include <hash.h>
 
+/* === ADD p4q22 === */
+struct frame;
+
 typedef enum _pme_type {
     PME_EXEC = 1,   // loading from executable
     PME_MMAP = 2,   // memory-mapped file
@@ -41,6 +44,14 @@ struct pme {
   /* === ADD START p3q3 ===*/
   struct list_elem mmap_elem;     // used to insert to struct mmap_meta.pme_list
   /* === ADD END p3q3 ===*/
+  /* === ADD START p4q22 ===*/
+  struct frame* frame;            // frame holding the page if loaded,
+                                  // protected by the frame lock
+  /* === ADD END p4q22 ===*/
+  /* === ADD START p4q23 ===*/
+  long long evict_stamp;          // eviction count when last evicted
+                                  // cold (clockpro policy), or 0
+  /* === ADD END p4q23 ===*/
 };
 
 // NOTE : pmap stands for pagemap,
@@ -15,6 +15,8 @@ void swap_table_init ( ) {
   swap_table.size = block_size (block) / SECTORS_IN_PAGE ;
   lock_init( &(swap_table.lock) );
   swap_table.used_map = bitmap_create ( swap_table.size );
+  /* === ADD p4q25 === */
+  swap_table.next = 0;
 
 }
 
@@ -23,13 +25,16 @@ void swap_in ( st_idx idx, void* kaddr ) {
   ASSERT( is_valid_idx(idx) );
   ASSERT (pg_ofs (kaddr) == 0);
 
-  lock_acquire( &swap_table.lock );
+  /* === MODIFY START p4q25 ===*/
+  // NOTE : the slot belongs to the caller's pme until it is
+  //        cleared, so it is read without the lock.
   // block read
   execute_swap( idx, kaddr, true );
   // swap clear
+  lock_acquire( &swap_table.lock );
   bitmap_set_multiple( swap_table.used_map, idx, 1, false );
-
   lock_release( &swap_table.lock );
+  /* === MODIFY END p4q25 ===*/
 }
 
 void swap_clear( st_idx idx ) {
@@ -39,20 +44,72 @@ void swap_clear( st_idx idx ) {
   lock_release( &swap_table.lock );
 }
 
+/* === MODIFY START p4q25 ===*/
 st_idx swap_out ( const void* kaddr ) {
   ASSERT (pg_ofs (kaddr) == 0);
 
-  lock_acquire( &swap_table.lock );
-  // fetch swap page
-  st_idx idx = bitmap_scan_and_flip( swap_table.used_map, 0, 1, false);
-  ASSERT( idx != BITMAP_ERROR );
-  // block write
-  execute_swap( idx, kaddr, false );
+  void* pages[1] = { (void*) kaddr };
+  st_idx idx;
+  swap_out_multi( pages, 1, &idx );
+  return idx;
+}
 
+// NOTE : reserves CNT slots, contiguous if possible, searching
+//        from where the last search ended (next fit), and stores
+//        them in IDX.
+static void _alloc_slots( size_t cnt, st_idx idx[] ) {
+  lock_acquire( &swap_table.lock );
+  st_idx first = bitmap_scan_and_flip( swap_table.used_map, swap_table.next, cnt, false );
+  if( first == BITMAP_ERROR ) {
+    first = bitmap_scan_and_flip( swap_table.used_map, 0, cnt, false );
+  }
+  if( first != BITMAP_ERROR ) {
+    for( size_t i = 0 ; i < cnt ; i++ ) { idx[i] = first + i; }
+  } else {
+    // no run is long enough; take single slots
+    for( size_t i = 0 ; i < cnt ; i++ ) {
+      idx[i] = bitmap_scan_and_flip( swap_table.used_map, 0, 1, false );
+      ASSERT( idx[i] != BITMAP_ERROR );
+    }
+  }
+  swap_table.next = idx[cnt - 1] + 1;
   lock_release( &swap_table.lock );
+}
 
-  return idx;
+// NOTE : writes the CNT pages PAGES[] to swap, and stores the slot
+//        of each in IDX[].  pages in consecutive slots go out as
+//        one request, and all requests are in flight at once.
+//        the swap lock is only held to reserve the slots.
+void swap_out_multi( void* const pages[], size_t cnt, st_idx idx[] ) {
+  struct block* block = block_get_role (BLOCK_SWAP);
+  void* buffers[SWAP_CLUSTER_MAX * SECTORS_IN_PAGE];
+  struct block_request requests[SWAP_CLUSTER_MAX];
+  size_t req_cnt = 0;
+
+  ASSERT( cnt > 0 && cnt <= SWAP_CLUSTER_MAX );
+  _alloc_slots( cnt, idx );
+
+  for( size_t i = 0 ; i < cnt ; i++ ) {
+    ASSERT( pg_ofs( pages[i] ) == 0 );
+    for( size_t s = 0 ; s < SECTORS_IN_PAGE ; s++ ) {
+      buffers[i * SECTORS_IN_PAGE + s] = (uint8_t*) pages[i] + s * BLOCK_SECTOR_SIZE;
+    }
+  }
+
+  // one request per run of consecutive slots
+  for( size_t i = 0 ; i < cnt ; ) {
+    size_t run = 1;
+    while( i + run < cnt && idx[i + run] == idx[i] + run ) { run++; }
+    block_request_init( &requests[req_cnt], true, get_block_idx( idx[i] ),
+                        run * SECTORS_IN_PAGE, &buffers[i * SECTORS_IN_PAGE] );
+    block_submit( block, &requests[req_cnt++] );
+    i += run;
+  }
+  for( size_t r = 0 ; r < req_cnt ; r++ ) {
+    block_wait( &requests[r] );
+  }
 }
+/* === MODIFY END p4q25 ===*/
 
 // NOTE : if is_read, then this is read operation
 //            if not, then this is write operation
@@ -63,15 +120,14 @@ void execute_swap( st_idx idx, void* buffer, bool is_read ) {
 
   bl_idx block_start_idx = get_block_idx( idx );
 
-  bl_idx i;
-  for( i = 0; i < BLOCKS_IN_PAGE ; i++ ) {
-
-    if( is_read ){  // read
-      block_read (block, block_start_idx + i, buffer + BLOCK_SECTOR_SIZE * i);
-    } else {        // write
-      block_write (block, block_start_idx + i, buffer + BLOCK_SECTOR_SIZE * i);
-    }
+  /* === MODIFY START p4q13 ===*/
+  // NOTE : the whole page moves as one multi-sector request
+  if( is_read ){  // read
+    block_read_multi (block, block_start_idx, BLOCKS_IN_PAGE, buffer);
+  } else {        // write
+    block_write_multi (block, block_start_idx, BLOCKS_IN_PAGE, buffer);
   }
+  /* === MODIFY END p4q13 ===*/
 }
 
 bl_idx get_block_idx( st_idx idx ) {
@@ -6,23 +6,32 @@
 #include "threads/synch.h"
 #include "devices/block.h"
 
+/* === MODIFY START p4q25 ===*/
+typedef size_t st_idx;         // index type for swap table
+typedef size_t bl_idx;         // index type for block operation querying
+/* === MODIFY END p4q25 ===*/
+
 #define BLOCKS_IN_PAGE 8
 #define BLOCKS_IN_PAGE_BITS 3
 #define SECTORS_IN_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+// === ADD p4q25 === //
+#define SWAP_CLUSTER_MAX 8      // most pages written by one swap_out_multi
 
 struct swap_table {
     struct bitmap*  used_map;
     struct lock     lock;
     int             size;
+    // === ADD p4q25 === //
+    st_idx          next;       // where the next slot search starts
 };
 
-typedef size_t st_idx;         // index type for swap table
-typedef size_t bl_idx;         // index type for block operation querying
 
 void swap_table_init ( );
 void swap_in ( st_idx, void* );
 void swap_clear ( st_idx );
 st_idx swap_out ( const void* );
+// === ADD p4q25 === //
+void swap_out_multi ( void* const [], size_t, st_idx [] );
 
 void execute_swap( st_idx, void*, bool );
 